@@ -0,0 +1,554 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <random>
+#include <functional>
+
+#include <lib.hpp>
+#include <conflict/conflict.hpp>
+
+// Benchmarks for the compiler front-end, sequence operators, timeline
+// finalization and headless playback. Results are written to stdout as JSON
+// so they can be compared between releases.
+
+enum {
+	OPT_HELP     = 0b01,
+	OPT_GENERATE = 0b10,
+};
+
+// Synthetic corpus
+struct Corpus {
+	size_t size  = 64;  // Number of statement blocks.
+	size_t sends = 4;   // Sends per block (joined by `$`).
+	size_t depth = 4;   // Nesting depth of sequence expressions.
+};
+
+inline std::string random_steps(std::mt19937& rng, size_t n) {
+	std::string out;
+	std::bernoulli_distribution beat { 0.4 };
+
+	for (size_t i = 0; i != n; ++i)
+		out += beat(rng) ? '!' : '.';
+
+	return out;
+}
+
+inline std::string random_leaf(std::mt19937& rng, size_t steps) {
+	std::bernoulli_distribution explicit_steps { 0.5 };
+	std::uniform_int_distribution<size_t> beats { 1, steps };
+
+	if (explicit_steps(rng))
+		return random_steps(rng, steps);
+
+	return std::to_string(beats(rng)) + ":" + std::to_string(steps);
+}
+
+// Returns an expression along with the length of the sequence it evaluates
+// to. Both operands of the boolean operators are kept the same length.
+inline std::pair<std::string, size_t> random_sequence(std::mt19937& rng, size_t depth) {
+	std::uniform_int_distribution<size_t> pick { 0, 5 };
+	std::uniform_int_distribution<size_t> small { 1, 8 };
+
+	if (depth == 0) {
+		size_t steps = small(rng) * 2;
+		return { random_leaf(rng, steps), steps };
+	}
+
+	auto [lhs, n] = random_sequence(rng, depth - 1);
+
+	switch (pick(rng)) {
+		case 0: {
+			auto [rhs, m] = random_sequence(rng, depth - 1);
+			return { "(" + lhs + ", " + rhs + ")", n + m };
+		}
+
+		case 1: return { "(" + lhs + " | " + random_leaf(rng, n) + ")", n };
+		case 2: return { "(" + lhs + " ^ " + random_leaf(rng, n) + ")", n };
+		case 3: return { "(" + lhs + " & " + random_leaf(rng, n) + ")", n };
+		case 4: return { "~(" + lhs + " < " + std::to_string(small(rng)) + ")", n };
+		default: return { "'(" + lhs + " ** 2)", n * 2 };
+	}
+}
+
+inline std::string random_literal(std::mt19937& rng, size_t depth) {
+	std::uniform_int_distribution<size_t> pick { 0, 3 };
+	std::uniform_int_distribution<size_t> small { 1, 99 };
+
+	if (depth == 0)
+		return std::to_string(small(rng));
+
+	std::string lhs = random_literal(rng, depth - 1);
+	std::string rhs = random_literal(rng, depth - 1);
+
+	switch (pick(rng)) {
+		case 0:  return "(" + lhs + " + " + rhs + ")";
+		case 1:  return "(" + lhs + " - " + rhs + ")";
+		case 2:  return lhs + " * " + rhs;
+		default: return lhs + " / " + rhs;
+	}
+}
+
+inline std::string generate(Corpus corpus, uint32_t seed = 0xCA7E) {
+	std::mt19937 rng { seed };
+	std::uniform_int_distribution<size_t> chan { cane::CHANNEL_MIN, cane::CHANNEL_MAX };
+	std::uniform_int_distribution<size_t> note { 36, 84 };
+
+	std::ostringstream ss;
+
+	ss << "bpm 120\nnote 60\n\n";
+	ss << "let qn bpm * 4\n\n";
+
+	for (size_t i = 0; i != corpus.size; ++i) {
+		ss << "# block " << i << "\n";
+
+		for (size_t j = 0; j != corpus.sends; ++j) {
+			ss << "send " << chan(rng) << " " << random_sequence(rng, corpus.depth).first;
+			ss << " map " << note(rng) << " " << note(rng) << " @ qn";
+			ss << (j + 1 != corpus.sends ? " $\n" : "\n");
+		}
+
+		ss << "\n";
+	}
+
+	return ss.str();
+}
+
+// Harness
+struct Result {
+	std::string name;
+	size_t size;
+	size_t iterations;
+	double ns_per_op;
+	double items_per_second;
+};
+
+// Written to after every iteration so the optimiser can't discard work.
+static volatile size_t sink = 0;
+static volatile double sink_lit = 0;
+
+// Run `fn` repeatedly, doubling the iteration count until the batch takes
+// at least `min_time`. `fn` returns the number of items it processed.
+inline Result measure(std::string name, size_t size, const std::function<size_t()>& fn) {
+	using clock = std::chrono::steady_clock;
+	constexpr auto min_time = std::chrono::milliseconds { 200 };
+
+	size_t iterations = 1;
+
+	while (true) {
+		size_t items = 0;
+
+		auto t1 = clock::now();
+			for (size_t i = 0; i != iterations; ++i)
+				items += fn();
+		auto t2 = clock::now();
+
+		sink = items;
+
+		if (t2 - t1 >= min_time or iterations >= (1u << 30)) {
+			double ns = std::chrono::duration<double, std::nano> { t2 - t1 }.count();
+
+			return {
+				std::move(name), size, iterations,
+				ns / iterations,
+				items / (ns / 1e9),
+			};
+		}
+
+		iterations *= 2;
+	}
+}
+
+inline std::ostream& operator<<(std::ostream& os, const Result& r) {
+	return cane::print(os,
+		"{ \"name\": \"", r.name, "\", ",
+		"\"size\": ", r.size, ", ",
+		"\"iterations\": ", r.iterations, ", ",
+		"\"ns_per_op\": ", r.ns_per_op, ", ",
+		"\"items_per_second\": ", r.items_per_second, " }"
+	);
+}
+
+inline void handler(cane::Phases phase, cane::View original, cane::View sv, std::string str) {
+	cane::report_error(std::cerr, phase, original, sv, str);
+}
+
+inline cane::Context context() {
+	cane::Context ctx { { [] (void*, cane::Reports, cane::Phases phase, cane::View original, cane::View sv, std::string str) {
+		handler(phase, original, sv, str);
+	} } };
+
+	ctx.global_bpm = cane::BPM_DEFAULT;
+	ctx.global_note = cane::NOTE_DEFAULT;
+
+	return ctx;
+}
+
+inline cane::Sequence random_seq(size_t n) {
+	std::mt19937 rng { static_cast<uint32_t>(n) };
+	std::bernoulli_distribution beat { 0.4 };
+
+	cane::Sequence seq;
+	seq.reserve(n);
+
+	for (size_t i = 0; i != n; ++i)
+		seq.emplace_back(beat(rng) ? cane::BEAT : cane::SKIP);
+
+	return seq;
+}
+
+inline cane::View view_of(const std::string& str) {
+	return { str.data(), str.data() + str.size() };
+}
+
+// Benchmarks
+inline void bench_lexer(std::vector<Result>& results, const std::string& corpus) {
+	cane::View src = view_of(corpus);
+
+	results.push_back(measure("lexer/next", corpus.size(), [&] {
+		cane::Context ctx = context();
+		cane::Lexer lx { src, ctx };
+
+		size_t n = 0;
+		while (lx.next().kind != cane::Symbols::TERMINATOR)
+			n++;
+
+		return n;
+	}));
+}
+
+inline void bench_parser(std::vector<Result>& results) {
+	std::mt19937 rng { 0xCA7E };
+
+	for (size_t depth: { 2u, 6u, 10u }) {
+		std::string lit = random_literal(rng, depth);
+		std::string seq = random_sequence(rng, depth).first;
+
+		results.push_back(measure("parse/literal_expr/depth_" + std::to_string(depth), lit.size(), [&] {
+			cane::Context ctx = context();
+			cane::Lexer lx { view_of(lit), ctx };
+			lx.next();
+
+			sink_lit = cane::literal_expr(ctx, lx, lx.peek.view, 0);
+			return lit.size();
+		}));
+
+		results.push_back(measure("parse/sequence_expr/depth_" + std::to_string(depth), seq.size(), [&] {
+			cane::Context ctx = context();
+			cane::Lexer lx { view_of(seq), ctx };
+			lx.next();
+
+			sink = cane::sequence_expr(ctx, lx, lx.peek.view, 0).size();
+			return seq.size();
+		}));
+	}
+}
+
+inline void bench_ops(std::vector<Result>& results) {
+	using Op = std::function<size_t(const cane::Sequence&)>;
+
+	// Every operator consumes its input so each iteration starts from a
+	// fresh copy. `sequence/copy` measures that overhead on its own.
+	const std::pair<const char*, Op> ops[] = {
+		{ "copy",    [] (auto& s) { cane::Sequence x = s; return x.size(); } },
+		{ "repeat",  [] (auto& s) { return cane::sequence_repeat  (s, 4).size(); } },
+		{ "reverse", [] (auto& s) { return cane::sequence_reverse (s).size(); } },
+		{ "rotl",    [] (auto& s) { return cane::sequence_rotl    (s, s.size() / 3).size(); } },
+		{ "rotr",    [] (auto& s) { return cane::sequence_rotr    (s, s.size() / 3).size(); } },
+		{ "invert",  [] (auto& s) { return cane::sequence_invert  (s).size(); } },
+		{ "cat",     [] (auto& s) { return cane::sequence_cat     (s, s).size(); } },
+		{ "or",      [] (auto& s) { return cane::sequence_or      (s, s).size(); } },
+		{ "and",     [] (auto& s) { return cane::sequence_and     (s, s).size(); } },
+		{ "xor",     [] (auto& s) { return cane::sequence_xor     (s, s).size(); } },
+		{ "car",     [] (auto& s) { return cane::sequence_car     (s).size(); } },
+		{ "cdr",     [] (auto& s) { return cane::sequence_cdr     (s).size(); } },
+		{ "minify",  [] (auto& s) { return cane::sequence_minify  (s).size(); } },
+		{ "len",     [] (auto& s) { return static_cast<size_t>(cane::sequence_len    (s)); } },
+		{ "beats",   [] (auto& s) { return static_cast<size_t>(cane::sequence_beats  (s)); } },
+		{ "skips",   [] (auto& s) { return static_cast<size_t>(cane::sequence_skips  (s)); } },
+	};
+
+	for (size_t size: { 64u, 4096u, 262144u }) {
+		cane::Sequence seq = random_seq(size);
+
+		for (auto& [name, op]: ops) {
+			results.push_back(measure(std::string { "sequence/" } + name, size, [&] {
+				sink = op(seq);
+				return seq.size();
+			}));
+		}
+
+		results.push_back(measure("sequence/compile", size, [&] {
+			return cane::sequence_compile(seq, 0, 0, cane::timeline_rate(seq.bpm)).size();
+		}));
+	}
+}
+
+inline void bench_finalize(std::vector<Result>& results, Corpus corpus) {
+	// Build an unsorted timeline the same way `statement` does for a
+	// block of sends.
+	for (size_t size: { 1024u, 16384u }) {
+		cane::Timeline raw;
+
+		for (size_t chan = 0; chan != corpus.sends; ++chan) {
+			cane::Timeline tl = cane::sequence_compile(random_seq(size + chan), chan, 0, raw.rate);
+
+			raw.duration = std::max(raw.duration, tl.duration);
+			raw.insert(raw.end(), tl.begin(), tl.end());
+		}
+
+		results.push_back(measure("timeline/realtime", raw.size(), [&] {
+			return cane::timeline_realtime(raw, cane::BPM_DEFAULT).size();
+		}));
+
+		cane::Timeline with_clock = cane::timeline_realtime(raw, cane::BPM_DEFAULT);
+
+		results.push_back(measure("timeline/sort", with_clock.size(), [&] {
+			return cane::timeline_sort(with_clock).size();
+		}));
+
+		cane::Timeline sorted = cane::timeline_sort(with_clock);
+
+		results.push_back(measure("timeline/bookend", sorted.size(), [&] {
+			return cane::timeline_bookend(sorted).size();
+		}));
+	}
+}
+
+inline void bench_compile(std::vector<Result>& results, const std::string& corpus) {
+	cane::View src = view_of(corpus);
+
+	results.push_back(measure("compile", corpus.size(), [&] {
+		sink = cane::compile(src, handler, handler, handler).size();
+		return corpus.size();
+	}));
+}
+
+// Static compilation
+// `CANE_STATIC` is a separate compiler so every operator it supports is
+// checked against `compile` event for event before anything is measured.
+inline void check_static_pattern(cane::View src, cane::TimelineView tl) {
+	cane::Timeline expect = cane::compile(src, handler, handler, handler);
+
+	auto same = [] (const cane::MidiEvent& a, const cane::MidiEvent& b) {
+		return a.time == b.time and a.data == b.data and a.port == b.port and a.size == b.size;
+	};
+
+	size_t i = 0;
+
+	while (i != std::min(tl.size(), expect.size()) and same(tl.begin()[i], expect[i]))
+		++i;
+
+	bool ports = tl.ports.size() == expect.ports.size() and
+		std::equal(tl.ports.begin(), tl.ports.end(), expect.ports.begin());
+
+	if (i != tl.size() or i != expect.size())
+		cane::general_error(cane::STR_STATIC_MISMATCH, src, i);
+
+	if (tl.duration != expect.duration or tl.bpm != expect.bpm or tl.rate != expect.rate or not ports)
+		cane::general_error(cane::STR_STATIC_MISMATCH, src, i);
+}
+
+#define CHECK_STATIC(str) \
+	check_static_pattern(cane::View { str }, [] { \
+		static constexpr auto tl = CANE_STATIC(str); \
+		return tl.view(); \
+	}())
+
+inline void check_static() {
+	CHECK_STATIC("bpm 120 note 60");
+	CHECK_STATIC("bpm 120 note 60 send 1 !..! map 69");
+	CHECK_STATIC("bpm 120 note 60 send 1 3:8 && 3:4 , !..!");
+
+	// Literals
+	CHECK_STATIC("bpm 90 note 48 let n 3 * (2 + 1) - 8 / 4 send 2 :n:16 @ bpm * 2 map note note + 7");
+	CHECK_STATIC("bpm 120 note 60 send 1 :len 3:8:16 map (len !.!! + 60) 64");
+
+	// Sequences
+	CHECK_STATIC("bpm 120 note 60 send 1 3:8 , :2 + 1:(4 * 2) / 2 , !.!. map 60 62 64");
+	CHECK_STATIC("bpm 120 note 60 send 1 !.!. | .!.! , 3:8 & 5:8 , 4:8 ^ 3:8");
+	CHECK_STATIC("bpm 120 note 60 send 1 (3:8 || 2:3) , (!. && !..) , (3:4 ^^ 2:5)");
+	CHECK_STATIC("bpm 120 note 60 send 1 3:8 < 1 , 3:8 > 2 , ~3:8 , '!!.. , !.!.. car , !.!.. cdr ** 3");
+
+	// Statements
+	CHECK_STATIC("bpm 120 note 60 3:8 => a alias drums 10 port synth send drums a ** 2 map 36 send 1 'a map 60 # end");
+	CHECK_STATIC("bpm 120 note 60 send 1 3:8 @ 90 $ send 2 3:4 @ 100 send 3 !.! @ 7 $ send 4 5:8 @ 150");
+}
+
+#undef CHECK_STATIC
+
+inline void bench_playback(std::vector<Result>& results, const std::string& corpus) {
+	constexpr uint32_t sample_rate = 48000u;
+	constexpr size_t buffer_bytes = 1u << 16;
+
+	cane::Timeline tl = cane::compile(view_of(corpus), handler, handler, handler);
+
+	for (uint32_t buffer_size: { 64u, 1024u }) {
+		auto start = [&] (cane::NullBackend& out) {
+			out.player.play(tl, false);
+			out.open(tl.ports);
+			out.reserve(tl.size());
+		};
+
+		auto play = [&] (cane::NullBackend& out) {
+			start(out);
+			out.run();
+		};
+
+		// Events due from `from` on which didn't land on the exact frame
+		// they are due at.
+		auto late = [&] (const cane::NullBackend& out, uint64_t from) {
+			if (out.events.size() != tl.size())
+				return tl.size();
+
+			size_t n = 0;
+
+			for (size_t i = 0; i != tl.size(); ++i) {
+				uint64_t due = cane::event_frame(tl[i].time, tl, sample_rate);
+				n += due >= from and out.events[i].frame != due;
+			}
+
+			return n;
+		};
+
+		// Every event should land on the exact frame it is due at as long
+		// as nothing had to be carried over to a later period.
+		{
+			cane::Player player;
+			cane::NullBackend out { player, sample_rate, buffer_size, buffer_bytes };
+			play(out);
+
+			if (size_t n = late(out, 0u); n != 0u)
+				cane::general_warning(cane::STR_LATE_EVENT, n);
+		}
+
+		// Stall rendering for long enough to drain the ring. Events due
+		// during the stall go out late but everything after it should be
+		// back on time.
+		{
+			constexpr size_t before = 16u;
+			constexpr size_t stall = cane::BUCKET_AHEAD + 4u;
+
+			cane::Player player;
+			cane::NullBackend out { player, sample_rate, buffer_size, buffer_bytes };
+			start(out);
+
+			out.run(before);
+			out.stall(stall);
+			out.run();
+
+			if (size_t n = late(out, (before + stall) * buffer_size); n != 0u)
+				cane::general_warning(cane::STR_LATE_EVENT, n);
+		}
+
+		results.push_back(measure("playback/null/buffer_" + std::to_string(buffer_size), tl.size(), [&] {
+			cane::Player player;
+			cane::NullBackend out { player, sample_rate, buffer_size, buffer_bytes };
+			play(out);
+
+			return out.events.size();
+		}));
+	}
+}
+
+int main(int argc, const char* argv[]) {
+	std::string_view size;
+	std::string_view sends;
+	std::string_view depth;
+	uint64_t flags;
+
+	auto parser = conflict::parser {
+		conflict::option { { 'h', "help", "show help" }, flags, OPT_HELP },
+		conflict::option { { 'g', "generate", "print the synthetic corpus and exit" }, flags, OPT_GENERATE },
+
+		conflict::string_option { { 's', "size", "number of statement blocks in the corpus" }, "n", size },
+		conflict::string_option { { 'n', "sends", "number of sends per block" }, "n", sends },
+		conflict::string_option { { 'd', "depth", "nesting depth of sequence expressions" }, "n", depth }
+	};
+
+	parser.apply_defaults();
+	auto status = parser.parse(argc - 1, argv + 1);
+
+	try {
+		switch (status.err) {
+			case conflict::error::invalid_option:
+				cane::general_error(cane::STR_OPT_INVALID_OPTION, status.what1);
+
+			case conflict::error::invalid_argument:
+				cane::general_error(cane::STR_OPT_INVALID_ARG, status.what1, status.what2);
+
+			case conflict::error::missing_argument:
+				cane::general_error(cane::STR_OPT_MISSING_ARG, status.what1);
+
+			case::conflict::error::ok:
+				break;
+		}
+
+		if (flags & OPT_HELP) {
+			parser.print_help();
+			return 0;
+		}
+
+		Corpus corpus {};
+
+		auto number = [] (std::string_view opt, std::string_view arg, size_t& out) {
+			if (arg.empty())
+				return;
+
+			cane::View sv { arg.data(), arg.data() + arg.size() };
+
+			if (not std::all_of(arg.begin(), arg.end(), [] (char c) { return c >= '0' and c <= '9'; }))
+				cane::general_error(cane::STR_OPT_INVALID_ARG, arg, opt);
+
+			out = cane::b10_decode(sv);
+		};
+
+		number("size", size, corpus.size);
+		number("sends", sends, corpus.sends);
+		number("depth", depth, corpus.depth);
+
+		corpus.sends = std::max<size_t>(corpus.sends, 1);
+
+		std::string src = generate(corpus);
+
+		if (flags & OPT_GENERATE) {
+			cane::print(std::cout, src);
+			return 0;
+		}
+
+		std::vector<Result> results;
+
+		check_static();
+
+		bench_lexer    (results, src);
+		bench_parser   (results);
+		bench_ops      (results);
+		bench_finalize (results, corpus);
+		bench_compile  (results, src);
+		bench_playback (results, src);
+
+		#ifdef NDEBUG
+			constexpr auto build = "release";
+		#else
+			constexpr auto build = "debug";
+		#endif
+
+		cane::println(std::cout, "{");
+		cane::println(std::cout, "  \"build\": \"", build, "\",");
+		cane::println(std::cout, "  \"corpus\": { \"size\": ", corpus.size, ", \"sends\": ", corpus.sends, ", \"depth\": ", corpus.depth, ", \"bytes\": ", src.size(), " },");
+		cane::println(std::cout, "  \"benchmarks\": [");
+
+		for (size_t i = 0; i != results.size(); ++i)
+			cane::println(std::cout, "    ", results[i], i + 1 != results.size() ? "," : "");
+
+		cane::println(std::cout, "  ]");
+		cane::println(std::cout, "}");
+	}
+
+	catch (cane::Error) {
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,356 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include <lib.hpp>
+#include <jack.hpp>
+#include <conflict/conflict.hpp>
+
+// End-to-end timing accuracy. Plays synthetic timelines through the real
+// JACK backend into a capture client in the same graph and compares the
+// frame every event arrives at with the frame it was scheduled for. Meant
+// to be run against a local server using the dummy driver, i.e.
+//
+//     jackd -d dummy -r 48000 &
+//     ./build/loopback > loopback.json
+//
+// Results are written to stdout as JSON.
+
+enum {
+	OPT_HELP = 0b1,
+};
+
+constexpr auto CSTR_CAPTURE = "cane loopback";
+
+constexpr size_t LOOPBACK_CHANNELS = 16u;  // Most channels a density is spread over.
+constexpr size_t LOOPBACK_PER_CHANNEL = 100u;  // Events per second per channel before spreading.
+
+// Captures everything arriving at its input with the absolute frame it
+// arrived at. Recording is preallocated and only armed while a run is
+// playing so the process callback never allocates.
+struct Capture {
+	jack_client_t* client = nullptr;
+	jack_port_t* port = nullptr;
+
+	std::vector<cane::Recorded> events;
+	std::atomic<size_t> count = 0;
+	std::atomic<bool> armed = false;
+
+	inline Capture() {
+		if (not (client = jack_client_open(CSTR_CAPTURE, JackOptions::JackNoStartServer, nullptr)))
+			cane::general_error(cane::STR_CONNECT_ERROR);
+
+		if (not (port = jack_port_register(client, cane::CSTR_PORT, JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0)))
+			cane::general_error(cane::STR_PORT_ERROR);
+
+		if (jack_set_process_callback(client, [] (jack_nframes_t nframes, void* arg) {
+			Capture& cap = *static_cast<Capture*>(arg);
+			void* buffer = jack_port_get_buffer(cap.port, nframes);
+
+			if (not cap.armed.load(std::memory_order_acquire))
+				return 0;
+
+			jack_nframes_t start = jack_last_frame_time(cap.client);
+			size_t n = cap.count.load(std::memory_order_relaxed);
+
+			for (uint32_t i = 0; i != jack_midi_get_event_count(buffer) and n != cap.events.size(); ++i) {
+				jack_midi_event_t ev;
+
+				if (jack_midi_event_get(&ev, buffer, i))
+					continue;
+
+				cane::Recorded& r = cap.events[n++];
+
+				r.frame = start + ev.time;
+				r.port = cane::PORT_DEFAULT;
+				r.size = std::min(ev.size, r.data.size());
+				r.data = {};
+
+				std::copy_n(ev.buffer, r.size, r.data.begin());
+			}
+
+			cap.count.store(n, std::memory_order_release);
+
+			return 0;
+		}, static_cast<void*>(this)))
+			cane::general_error(cane::STR_PROCESS_CALLBACK_ERROR);
+
+		if (jack_activate(client))
+			cane::general_error(cane::STR_ACTIVATE_ERROR);
+	}
+
+	Capture(const Capture&) = delete;
+	Capture& operator=(const Capture&) = delete;
+
+	inline ~Capture() {
+		jack_deactivate(client);
+		jack_port_unregister(client, port);
+		jack_client_close(client);
+	}
+
+	inline void arm(size_t n) {
+		events.resize(n);
+		count.store(0, std::memory_order_relaxed);
+		armed.store(true, std::memory_order_release);
+	}
+
+	inline void disarm() {
+		armed.store(false, std::memory_order_release);
+	}
+
+	inline void buffer_size(jack_nframes_t frames) {
+		if (jack_set_buffer_size(client, frames))
+			cane::general_error(cane::STR_BUFFER_SIZE_ERROR, frames);
+	}
+};
+
+// Harness
+struct Result {
+	jack_nframes_t buffer_size;
+	size_t density;  // Requested events per second.
+
+	size_t scheduled;
+	size_t captured;
+	size_t lost;
+	uint64_t xruns;
+
+	double events_per_second;  // Actual density of the timeline.
+	uint32_t sample_rate;
+
+	// Distance from the scheduled frame, in frames.
+	uint64_t p50, p90, p99, p999, max;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const Result& r) {
+	auto us = [&] (uint64_t frames) {
+		return cane::UnitMillis { cane::frame_time(frames, r.sample_rate) }.count() * 1000.0;
+	};
+
+	return cane::print(os,
+		"{ \"buffer_size\": ", r.buffer_size, ", ",
+		"\"density\": ", r.density, ", ",
+		"\"events_per_second\": ", r.events_per_second, ", ",
+		"\"scheduled\": ", r.scheduled, ", ",
+		"\"captured\": ", r.captured, ", ",
+		"\"lost\": ", r.lost, ", ",
+		"\"xruns\": ", r.xruns, ", ",
+		"\"jitter_frames\": { ",
+			"\"p50\": ", r.p50, ", \"p90\": ", r.p90, ", \"p99\": ", r.p99, ", ",
+			"\"p99.9\": ", r.p999, ", \"max\": ", r.max, " }, ",
+		"\"jitter_us\": { ",
+			"\"p50\": ", us(r.p50), ", \"p90\": ", us(r.p90), ", \"p99\": ", us(r.p99), ", ",
+			"\"p99.9\": ", us(r.p999), ", \"max\": ", us(r.max), " } }"
+	);
+}
+
+inline void handler(cane::Phases phase, cane::View original, cane::View sv, std::string str) {
+	cane::report_error(std::cerr, phase, original, sv, str);
+}
+
+// Every step of every channel is a beat so the density only depends on
+// the tempo and the number of channels it is spread over.
+inline std::string generate(size_t density, size_t seconds) {
+	size_t channels = std::clamp<size_t>(density / LOOPBACK_PER_CHANNEL, 1u, LOOPBACK_CHANNELS);
+	size_t rate = std::max<size_t>(density * 30u / channels, 1u);  // Steps per minute, each beat is an on and an off.
+	size_t steps = std::max<size_t>(rate * seconds / 60u, 1u);
+
+	std::ostringstream ss;
+
+	ss << "bpm 120\nnote 60\n\n";
+
+	for (size_t chan = 0; chan != channels; ++chan) {
+		ss << "send " << chan + cane::CHANNEL_MIN << " " << steps << ":" << steps << " @ " << rate;
+		ss << (chan + 1 != channels ? " $\n" : "\n");
+	}
+
+	return ss.str();
+}
+
+inline Result run(Capture& capture, jack_nframes_t buffer_size, size_t density, size_t seconds) {
+	using namespace std::chrono_literals;
+
+	std::string src = generate(density, seconds);
+	cane::Timeline compiled = cane::compile({ src.data(), src.data() + src.size() }, handler, handler, handler);
+	cane::TimelineView tl { compiled };
+
+	capture.buffer_size(buffer_size);
+
+	cane::Player player;
+	cane::JackBackend jack { player };
+
+	jack.open({ cane::port_name(cane::CSTR_PORT) });
+	jack.connect(0, jack_port_name(capture.port));
+
+	capture.arm(tl.size());
+
+	player.play(tl);
+	jack.activate();
+
+	while (not player.done.load(std::memory_order_acquire))
+		std::this_thread::sleep_for(10ms);
+
+	// The capture client runs after us in the same cycle but give it a
+	// couple of periods regardless.
+	std::this_thread::sleep_for(cane::frame_time(2u * buffer_size, player.sample_rate));
+	capture.disarm();
+
+	Result r {};
+
+	r.buffer_size = buffer_size;
+	r.density = density;
+	r.scheduled = tl.size();
+	r.captured = capture.count.load(std::memory_order_acquire);
+	r.xruns = player.stats.xruns;
+	r.sample_rate = player.sample_rate;
+	r.events_per_second = tl.size() / cane::timeline_seconds(tl, tl.duration).count();
+
+	// Events are written in timeline order so arrivals are matched up in
+	// order too, skipping over any that never arrived. The very first
+	// event goes out at the start of the first period which fixes where
+	// playback started.
+	cane::Histogram jitter;
+
+	const cane::MidiEvent* it = tl.begin();
+	bool anchored = false;
+	int64_t start = 0;
+
+	for (size_t i = 0; i != r.captured; ++i) {
+		const cane::Recorded& ev = capture.events[i];
+
+		while (it != tl.end() and (it->size != ev.size or not std::equal(ev.data.begin(), ev.data.begin() + ev.size, it->data.begin()))) {
+			r.lost++;
+			++it;
+		}
+
+		if (it == tl.end())
+			break;
+
+		int64_t due = cane::event_frame(it->time, tl, r.sample_rate);
+		int64_t arrived = ev.frame;
+
+		if (not anchored) {
+			start = arrived - due;
+			anchored = true;
+		}
+
+		jitter.record(std::abs(arrived - due - start));
+		++it;
+	}
+
+	r.lost += tl.end() - it;
+
+	r.p50  = jitter.percentile(50.0);
+	r.p90  = jitter.percentile(90.0);
+	r.p99  = jitter.percentile(99.0);
+	r.p999 = jitter.percentile(99.9);
+	r.max  = jitter.max;
+
+	return r;
+}
+
+int main(int argc, const char* argv[]) {
+	std::string_view buffers;
+	std::string_view densities;
+	std::string_view seconds;
+	uint64_t flags;
+
+	auto parser = conflict::parser {
+		conflict::option { { 'h', "help", "show help" }, flags, OPT_HELP },
+
+		conflict::string_option { { 'b', "buffers", "comma separated buffer sizes in frames" }, "sizes", buffers },
+		conflict::string_option { { 'd', "densities", "comma separated densities in events per second" }, "densities", densities },
+		conflict::string_option { { 's', "seconds", "length of each run" }, "n", seconds }
+	};
+
+	parser.apply_defaults();
+	auto status = parser.parse(argc - 1, argv + 1);
+
+	try {
+		switch (status.err) {
+			case conflict::error::invalid_option:
+				cane::general_error(cane::STR_OPT_INVALID_OPTION, status.what1);
+
+			case conflict::error::invalid_argument:
+				cane::general_error(cane::STR_OPT_INVALID_ARG, status.what1, status.what2);
+
+			case conflict::error::missing_argument:
+				cane::general_error(cane::STR_OPT_MISSING_ARG, status.what1);
+
+			case::conflict::error::ok:
+				break;
+		}
+
+		if (flags & OPT_HELP) {
+			parser.print_help();
+			return 0;
+		}
+
+		if (buffers.empty())   buffers   = "64,256,1024";
+		if (densities.empty()) densities = "100,1000,10000";
+		if (seconds.empty())   seconds   = "4";
+
+		auto number = [] (std::string_view opt, std::string_view arg) -> size_t {
+			cane::View sv { arg.data(), arg.data() + arg.size() };
+
+			if (arg.empty() or not std::all_of(arg.begin(), arg.end(), [] (char c) { return c >= '0' and c <= '9'; }))
+				cane::general_error(cane::STR_OPT_INVALID_ARG, arg, opt);
+
+			return cane::b10_decode(sv);
+		};
+
+		auto numbers = [&] (std::string_view opt, std::string_view arg) {
+			std::vector<size_t> out;
+
+			while (true) {
+				std::string_view entry = arg.substr(0, arg.find(','));
+				out.push_back(number(opt, entry));
+
+				if (entry.size() == arg.size())
+					break;
+
+				arg.remove_prefix(entry.size() + 1);
+			}
+
+			return out;
+		};
+
+		std::vector<size_t> sizes = numbers("buffers", buffers);
+		std::vector<size_t> rates = numbers("densities", densities);
+		size_t length = std::max<size_t>(number("seconds", seconds), 1u);
+
+		Capture capture;
+		std::vector<Result> results;
+
+		for (size_t size: sizes) {
+			for (size_t density: rates)
+				results.push_back(run(capture, size, density, length));
+		}
+
+		#ifdef NDEBUG
+			constexpr auto build = "release";
+		#else
+			constexpr auto build = "debug";
+		#endif
+
+		cane::println(std::cout, "{");
+		cane::println(std::cout, "  \"build\": \"", build, "\",");
+		cane::println(std::cout, "  \"seconds\": ", length, ",");
+		cane::println(std::cout, "  \"runs\": [");
+
+		for (size_t i = 0; i != results.size(); ++i)
+			cane::println(std::cout, "    ", results[i], i + 1 != results.size() ? "," : "");
+
+		cane::println(std::cout, "  ]");
+		cane::println(std::cout, "}");
+	}
+
+	catch (cane::Error) {
+		return 1;
+	}
+
+	return 0;
+}
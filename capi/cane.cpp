@@ -0,0 +1,198 @@
+#include <cstddef>
+
+#include <lib.hpp>
+#include <cane.h>
+
+// C interface.
+// Thin wrappers over `cane::Engine`. Exceptions can't cross into C so any
+// entry point that might allocate catches everything.
+
+static_assert(sizeof(cane_event) == sizeof(cane::MidiEvent));
+static_assert(offsetof(cane_event, time) == offsetof(cane::MidiEvent, time));
+static_assert(offsetof(cane_event, data) == offsetof(cane::MidiEvent, data));
+static_assert(offsetof(cane_event, port) == offsetof(cane::MidiEvent, port));
+static_assert(offsetof(cane_event, size) == offsetof(cane::MidiEvent, size));
+
+static_assert(static_cast<int>(cane::Reports::ERROR)   == CANE_ERROR);
+static_assert(static_cast<int>(cane::Reports::WARNING) == CANE_WARNING);
+static_assert(static_cast<int>(cane::Reports::NOTICE)  == CANE_NOTICE);
+
+static_assert(static_cast<int>(cane::Phases::INTERNAL)  == CANE_INTERNAL);
+static_assert(static_cast<int>(cane::Phases::ENCODING)  == CANE_ENCODING);
+static_assert(static_cast<int>(cane::Phases::LEXICAL)   == CANE_LEXICAL);
+static_assert(static_cast<int>(cane::Phases::SYNTACTIC) == CANE_SYNTACTIC);
+static_assert(static_cast<int>(cane::Phases::SEMANTIC)  == CANE_SEMANTIC);
+
+struct cane_engine {
+	cane::Engine engine;
+
+	cane_diagnostic_fn fn = nullptr;
+	void* user = nullptr;
+};
+
+struct cane_result {
+	cane::Result result;
+	std::vector<cane_diagnostic> diagnostics;  // Messages point into `result`.
+};
+
+namespace {
+	inline cane_diagnostic diagnostic(const cane::Diagnostic& d) {
+		return {
+			static_cast<cane_severity>(d.kind),
+			static_cast<cane_phase>(d.phase),
+			d.location.line,
+			d.location.column,
+			d.offset,
+			d.length,
+			d.message.c_str(),
+		};
+	}
+
+	inline const cane::Timeline* timeline(const cane_result* r) {
+		return r != nullptr ? r->result.timeline.get() : nullptr;
+	}
+}
+
+extern "C" {
+
+CANE_API uint32_t cane_abi_version(void) {
+	return CANE_ABI_VERSION;
+}
+
+// Engine
+CANE_API cane_engine* cane_engine_create(void) {
+	try {
+		cane_engine* e = new cane_engine {};
+
+		e->engine.user = e;
+		e->engine.listener = [] (void* user, const cane::Diagnostic& d) {
+			cane_engine& e = *static_cast<cane_engine*>(user);
+
+			if (e.fn == nullptr)
+				return;
+
+			cane_diagnostic out = diagnostic(d);
+			e.fn(e.user, &out);
+		};
+
+		return e;
+	}
+
+	catch (...) {
+		return nullptr;
+	}
+}
+
+CANE_API void cane_engine_destroy(cane_engine* engine) {
+	delete engine;
+}
+
+CANE_API void cane_engine_set_callback(cane_engine* engine, cane_diagnostic_fn fn, void* user) {
+	engine->fn = fn;
+	engine->user = user;
+}
+
+CANE_API void cane_engine_set_cache(cane_engine* engine, size_t results) {
+	engine->engine.cache_max = results;
+	engine->engine.cache.clear();
+}
+
+CANE_API void cane_engine_set_budget(cane_engine* engine, size_t memory, size_t events) {
+	engine->engine.budget.memory = memory != 0 ? memory : cane::BUDGET_MEMORY;
+	engine->engine.budget.events = events != 0 ? events : cane::BUDGET_EVENTS;
+
+	// Cached results were compiled under the old budget.
+	engine->engine.cache.clear();
+}
+
+CANE_API cane_result* cane_compile(cane_engine* engine, const char* src, size_t length) {
+	try {
+		cane_result* r = new cane_result {};
+
+		r->result = engine->engine.compile({ src, src + length });
+		r->diagnostics.reserve(r->result.diagnostics.size());
+
+		for (const cane::Diagnostic& d: r->result.diagnostics)
+			r->diagnostics.push_back(diagnostic(d));
+
+		return r;
+	}
+
+	catch (...) {
+		return nullptr;
+	}
+}
+
+// Result
+CANE_API void cane_result_destroy(cane_result* result) {
+	delete result;
+}
+
+CANE_API int cane_result_ok(const cane_result* result) {
+	return timeline(result) != nullptr;
+}
+
+CANE_API size_t cane_result_diagnostic_count(const cane_result* result) {
+	return result != nullptr ? result->diagnostics.size() : 0u;
+}
+
+CANE_API const cane_diagnostic* cane_result_diagnostic(const cane_result* result, size_t i) {
+	return i < cane_result_diagnostic_count(result) ? &result->diagnostics[i] : nullptr;
+}
+
+CANE_API size_t cane_result_event_count(const cane_result* result) {
+	const cane::Timeline* tl = timeline(result);
+	return tl != nullptr ? tl->size() : 0u;
+}
+
+CANE_API const cane_event* cane_result_events(const cane_result* result) {
+	const cane::Timeline* tl = timeline(result);
+	return tl != nullptr ? reinterpret_cast<const cane_event*>(tl->data()) : nullptr;
+}
+
+CANE_API int64_t cane_result_duration(const cane_result* result) {
+	const cane::Timeline* tl = timeline(result);
+	return tl != nullptr ? tl->duration : 0;
+}
+
+CANE_API uint64_t cane_result_bpm(const cane_result* result) {
+	const cane::Timeline* tl = timeline(result);
+	return tl != nullptr ? tl->bpm : 0u;
+}
+
+CANE_API uint64_t cane_result_rate(const cane_result* result) {
+	const cane::Timeline* tl = timeline(result);
+	return tl != nullptr ? tl->rate : 0u;
+}
+
+CANE_API double cane_result_seconds(const cane_result* result, int64_t tick) {
+	const cane::Timeline* tl = timeline(result);
+	return tl != nullptr ? cane::timeline_seconds(*tl, tick).count() : 0.0;
+}
+
+CANE_API size_t cane_result_port_count(const cane_result* result) {
+	const cane::Timeline* tl = timeline(result);
+	return tl != nullptr ? tl->ports.size() : 0u;
+}
+
+CANE_API const char* cane_result_port_name(const cane_result* result, size_t i) {
+	return i < cane_result_port_count(result) ? timeline(result)->ports[i].data() : nullptr;
+}
+
+CANE_API int cane_result_write_smf(const cane_result* result, const char* path) {
+	const cane::Timeline* tl = timeline(result);
+
+	if (tl == nullptr)
+		return -1;
+
+	try {
+		std::ofstream os(path, std::ios::binary);
+		return os and cane::render_smf(os, *tl).flush() ? 0 : -1;
+	}
+
+	catch (...) {
+		return -1;
+	}
+}
+
+}
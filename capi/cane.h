@@ -0,0 +1,128 @@
+#ifndef CANE_H
+#define CANE_H
+
+/* C interface to cane.
+ *
+ * Compiles sources in-process into timelines of MIDI events. Engines are
+ * independent of each other so each thread can compile on its own engine
+ * at the same time. Nothing is printed and no exception ever crosses this
+ * interface, everything that happened is in the result.
+ *
+ *     cane_engine* engine = cane_engine_create();
+ *     cane_result* result = cane_compile(engine, src, strlen(src));
+ *
+ *     if (cane_result_ok(result))
+ *         play(cane_result_events(result), cane_result_event_count(result));
+ *
+ *     cane_result_destroy(result);
+ *     cane_engine_destroy(engine);
+ *
+ * Build with `make lib` which produces `build/libcane.so`.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+	#define CANE_API __attribute__((visibility("default")))
+#else
+	#define CANE_API
+#endif
+
+/* Bumped whenever anything below changes incompatibly. */
+#define CANE_ABI_VERSION 1
+
+typedef struct cane_engine cane_engine;
+typedef struct cane_result cane_result;
+
+typedef enum {
+	CANE_ERROR   = 0,
+	CANE_WARNING = 1,
+	CANE_NOTICE  = 2
+} cane_severity;
+
+typedef enum {
+	CANE_INTERNAL  = 0,
+	CANE_ENCODING  = 1,
+	CANE_LEXICAL   = 2,
+	CANE_SYNTACTIC = 3,
+	CANE_SEMANTIC  = 4
+} cane_phase;
+
+typedef struct {
+	cane_severity severity;
+	cane_phase phase;
+
+	size_t line;    /* Starting at 1. */
+	size_t column;  /* Starting at 1. */
+	size_t offset;  /* Bytes from the start of the source. */
+	size_t length;  /* Bytes. */
+
+	const char* message;  /* NUL terminated. */
+} cane_diagnostic;
+
+/* Events are in ticks, see `cane_result_rate` and `cane_result_seconds`. */
+typedef struct {
+	int64_t time;
+	uint8_t data[3];  /* Only the first `size` bytes go out on the wire. */
+	uint8_t port;     /* 0xFF for every port. */
+	uint8_t size;
+} cane_event;
+
+/* Called for every diagnostic as it is reported. The diagnostic is only
+ * valid for the duration of the call. */
+typedef void (*cane_diagnostic_fn)(void* user, const cane_diagnostic* diagnostic);
+
+CANE_API uint32_t cane_abi_version(void);
+
+/* Engine */
+CANE_API cane_engine* cane_engine_create(void);
+CANE_API void cane_engine_destroy(cane_engine* engine);
+
+CANE_API void cane_engine_set_callback(cane_engine* engine, cane_diagnostic_fn fn, void* user);
+CANE_API void cane_engine_set_cache(cane_engine* engine, size_t results);
+
+/* Most a compile may allocate: no sequence and not the result may be over
+ * `memory` bytes and the result may have at most `events` events. Anything
+ * bigger fails with a diagnostic instead of being allocated. Zero leaves a
+ * limit at its default. */
+CANE_API void cane_engine_set_budget(cane_engine* engine, size_t memory, size_t events);
+
+/* Returns null only if out of memory. Compiling an unchanged source again
+ * is answered from the engine's cache. */
+CANE_API cane_result* cane_compile(cane_engine* engine, const char* src, size_t length);
+
+/* Result */
+CANE_API void cane_result_destroy(cane_result* result);
+
+CANE_API int cane_result_ok(const cane_result* result);
+
+CANE_API size_t cane_result_diagnostic_count(const cane_result* result);
+CANE_API const cane_diagnostic* cane_result_diagnostic(const cane_result* result, size_t i);
+
+/* Everything below is empty or zero if compilation failed. */
+CANE_API size_t cane_result_event_count(const cane_result* result);
+CANE_API const cane_event* cane_result_events(const cane_result* result);
+
+CANE_API int64_t cane_result_duration(const cane_result* result);  /* Ticks. */
+CANE_API uint64_t cane_result_bpm(const cane_result* result);
+CANE_API uint64_t cane_result_rate(const cane_result* result);     /* Ticks per minute at `bpm`. */
+
+/* Real time of a tick, following tempo changes. */
+CANE_API double cane_result_seconds(const cane_result* result, int64_t tick);
+
+CANE_API size_t cane_result_port_count(const cane_result* result);
+CANE_API const char* cane_result_port_name(const cane_result* result, size_t i);
+
+/* Returns 0 on success. */
+CANE_API int cane_result_write_smf(const cane_result* result, const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
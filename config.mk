@@ -5,6 +5,8 @@ CXXSTD ?= c++17
 
 BUILD_DIR=build
 SRC_DIR=src
+BENCH_DIR=bench
+CAPI_DIR=capi
 
 SRCS=$(basename $(subst $(SRC_DIR),$(BUILD_DIR),$(wildcard $(SRC_DIR)/*.cpp)))
 
@@ -15,6 +17,7 @@ LIBS=-ljack
 # Flags
 dbg ?= yes
 san ?= no
+trace ?= yes
 
 # Debug flags
 ifeq ($(dbg),no)
@@ -33,3 +36,10 @@ else
 $(error san should be either yes or no)
 endif
 
+# Tracing flags
+ifeq ($(trace),no)
+	CXXFLAGS+=-DCANE_NO_TRACING
+else ifeq ($(trace),yes)
+else
+$(error trace should be either yes or no)
+endif
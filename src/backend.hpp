@@ -0,0 +1,151 @@
+#ifndef CANE_BACKEND_HPP
+#define CANE_BACKEND_HPP
+
+namespace cane {
+
+// Output backends.
+// A backend owns the ports events are written to and the clock playback
+// runs on. It has to:
+//
+// - open: register one output per port name of the timeline.
+// - call `Player::process(period, nframes)` once per period, with
+//   `Player::sample_rate` and `Player::buffer_size` kept up to date.
+// - provide a period with the port buffers cleared which has:
+//     `ports()`                            number of ports opened.
+//     `reserve(port, offset, size)`        space for an event's bytes,
+//                                          null if the buffer is full.
+//     `room(port)`                         largest event that still fits.
+//     `transport()`                        position when following transport.
+//     `lost()`                             events lost by the backend itself.
+//
+// JACK is implemented in `jack.hpp` which `lib.hpp` leaves out so that
+// nothing else depends on it.
+
+// An event as it was written, at the frame it was written for.
+struct Recorded {
+	uint64_t frame;
+	uint8_t port;
+	uint8_t size;
+	std::array<uint8_t, 3> data;  // Zeroed past `size`.
+};
+
+// Simulated output.
+// The clock only advances one period at a time when asked to and port
+// buffers have a fixed size like JACK's. Every event written is recorded
+// in memory with its frame so playback can be checked and benchmarked
+// without a server. Rendering happens between periods on the calling thread
+// when the player was started without one, which makes runs deterministic.
+struct NullBackend {
+	Player& player;
+
+	size_t nports = 0;
+	size_t buffer_bytes = 0;
+	std::array<size_t, PORT_MAX> used {};  // Bytes written this period.
+
+	uint64_t frame = 0;  // Start of the next period.
+	bool rolling = true;
+
+	size_t stalled = 0;  // Periods left to run without rendering.
+
+	std::vector<Recorded> events;
+
+	inline NullBackend(Player& player_, uint32_t sample_rate, uint32_t buffer_size, size_t buffer_bytes_):
+		player(player_), buffer_bytes(buffer_bytes_)
+	{
+		player.sample_rate = sample_rate;
+		player.buffer_size = buffer_size;
+	}
+
+	inline void open(PortView names) {
+		nports = std::clamp<size_t>(names.size(), 1u, PORT_MAX);
+	}
+
+	// Room for the recording up front so that it doesn't allocate while
+	// being timed.
+	inline void reserve(size_t n) {
+		events.reserve(n);
+	}
+
+	// Clock.
+	inline void locate(uint64_t frame_) {
+		frame = frame_;
+	}
+
+	// Hold off rendering for the next `periods` periods as if the render
+	// thread had stalled. Only has an effect without a render thread.
+	inline void stall(size_t periods) {
+		stalled = periods;
+	}
+
+	// Run a single period, returns false once playback is done.
+	inline bool cycle() {
+		uint32_t nframes = player.buffer_size;
+
+		if (stalled != 0)
+			stalled--;
+
+		else if (player.renderer and not player.renderer->thread.joinable())
+			player.renderer->fill();
+
+		used.fill(0u);
+		player.process(*this, nframes);
+
+		frame += nframes;
+
+		return not player.done.load(std::memory_order_acquire);
+	}
+
+	// Returns the number of periods run.
+	inline size_t run(size_t max = std::numeric_limits<size_t>::max()) {
+		size_t n = 0;
+
+		while (n != max) {
+			n++;
+
+			if (not cycle())
+				break;
+		}
+
+		return n;
+	}
+
+	// Period.
+	inline size_t ports() const {
+		return nports;
+	}
+
+	inline size_t room(uint8_t port) const {
+		size_t capacity = buffer_bytes > JACK_MIDI_HEADER_SIZE ? buffer_bytes - JACK_MIDI_HEADER_SIZE : 0u;
+		size_t free = capacity - std::min(capacity, used[port]);
+
+		return free > JACK_MIDI_EVENT_SIZE ? free - JACK_MIDI_EVENT_SIZE : 0u;
+	}
+
+	inline uint8_t* reserve(uint8_t port, uint32_t offset, size_t size) {
+		if (room(port) < size or size > Recorded {}.data.size())
+			return nullptr;
+
+		used[port] += event_footprint(size);
+
+		Recorded& r = events.emplace_back();
+
+		r.frame = frame + offset;
+		r.port = port;
+		r.size = size;
+		r.data = {};
+
+		return r.data.data();
+	}
+
+	inline Transport transport() const {
+		return { rolling, frame };
+	}
+
+	constexpr size_t lost() const {
+		return 0u;
+	}
+};
+
+}
+
+#endif
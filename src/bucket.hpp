@@ -0,0 +1,139 @@
+#ifndef CANE_BUCKET_HPP
+#define CANE_BUCKET_HPP
+
+namespace cane {
+
+// Period buckets.
+// A render thread slices the timeline into one bucket per JACK period ahead
+// of time, working out which events fall in the period and the frame each
+// one should be written at. Buckets are handed to the process callback
+// through a wait-free single producer/single consumer ring so that all the
+// callback has to do is copy events into the port buffer.
+
+constexpr size_t BUCKET_CAPACITY = 1u << 9;  // Events with their own frame offset.
+constexpr size_t BUCKET_AHEAD    = 8u;       // Periods rendered ahead of playback.
+
+// Frame at which an event is due, counted from the start of playback.
+// Without tempo changes this is exact and split so that long timelines on
+// fine grids can't overflow, otherwise it goes through the tempo map.
+inline uint64_t event_frame(Tick time, TimelineView tl, uint64_t sample_rate) {
+	if (time <= 0)
+		return 0;
+
+	if (not tl.tempo.empty())
+		return static_cast<uint64_t>(timeline_seconds(tl, time).count() * static_cast<double>(sample_rate));
+
+	uint64_t t = time;
+	uint64_t per_min = 60u * sample_rate;
+
+	return (t / tl.rate) * per_min + (t % tl.rate) * per_min / tl.rate;
+}
+
+constexpr UnitSeconds frame_time(uint64_t frame, uint64_t sample_rate) {
+	return UnitSeconds { static_cast<double>(frame) / static_cast<double>(sample_rate) };
+}
+
+struct Bucket {
+	const MidiEvent* first = nullptr;
+	const MidiEvent* last  = nullptr;
+
+	uint64_t frame = 0;       // First frame of the period.
+	uint64_t generation = 0;  // Bumped on every seek so stale buckets can be told apart.
+
+	uint32_t frames = 0;  // Length of the period this was rendered for.
+	bool final = false;   // No more buckets follow.
+
+	// Events past `BUCKET_CAPACITY` share the final offset which keeps
+	// them in order at the cost of some accuracy in very dense periods.
+	std::array<uint32_t, BUCKET_CAPACITY> offsets {};
+
+	constexpr uint32_t offset(size_t i) const {
+		return offsets[std::min(i, BUCKET_CAPACITY - 1)];
+	}
+};
+
+// Fill `b` with every event due in the `frames` frames starting at `frame`.
+// Events that are already late (i.e. after a buffer size change) are
+// written at the start of the period.
+inline void bucket_fill(
+	Bucket& b,
+	TimelineView tl,
+	const MidiEvent*& it,
+	uint64_t& frame,
+	uint32_t frames,
+	uint64_t sample_rate
+) {
+	b.first = it;
+	b.frame = frame;
+	b.frames = frames;
+
+	size_t i = 0;
+	uint64_t limit = frame + frames;
+	uint32_t off = 0;
+
+	for (; it != tl.end(); ++it, ++i) {
+		uint64_t at = event_frame(it->time, tl, sample_rate);
+
+		if (at >= limit)
+			break;
+
+		off = at > frame ? at - frame : 0u;
+
+		if (i < BUCKET_CAPACITY)
+			b.offsets[i] = off;
+	}
+
+	// Everything past capacity goes out with the last event.
+	if (i > BUCKET_CAPACITY)
+		b.offsets[BUCKET_CAPACITY - 1] = off;
+
+	b.last = it;
+	b.final = it == tl.end();
+
+	frame = limit;
+}
+
+// Wait-free single producer/single consumer ring. The producer fills the
+// slot returned by `acquire` then calls `publish`, the consumer reads the
+// slot returned by `peek` then calls `release`. Neither side ever blocks.
+template <typename T, size_t N>
+struct SpscRing {
+	static_assert((N & (N - 1)) == 0, "capacity must be a power of two");
+
+	std::array<T, N> slots {};
+
+	alignas(64) std::atomic<size_t> head = 0;  // Next slot to consume.
+	alignas(64) std::atomic<size_t> tail = 0;  // Next slot to produce.
+
+	inline T* acquire() {
+		size_t t = tail.load(std::memory_order_relaxed);
+
+		if (t - head.load(std::memory_order_acquire) == N)
+			return nullptr;
+
+		return &slots[t % N];
+	}
+
+	inline void publish() {
+		tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	inline const T* peek() const {
+		size_t h = head.load(std::memory_order_relaxed);
+
+		if (h == tail.load(std::memory_order_acquire))
+			return nullptr;
+
+		return &slots[h % N];
+	}
+
+	inline void release() {
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+};
+
+using BucketRing = SpscRing<Bucket, BUCKET_AHEAD>;
+
+}
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef CANE_CACHE_HPP
+#define CANE_CACHE_HPP
+
+namespace cane {
+
+// Precompiled timelines.
+// A compiled timeline can be saved to disk alongside a hash of the source it
+// was compiled from. The file is a fixed header followed by the events, the
+// tempo map and the port names in their in-memory layout so that it can be
+// mapped and played directly without parsing or copying anything.
+
+constexpr std::array<char, 4> CACHE_MAGIC = { 'C', 'A', 'N', 'E' };
+constexpr uint32_t CACHE_VERSION = 5u;
+
+static_assert(std::is_trivially_copyable_v<MidiEvent>);
+static_assert(std::is_trivially_copyable_v<TempoPoint>);
+static_assert(std::is_trivially_copyable_v<PortName>);
+
+struct CacheHeader {
+	std::array<char, 4> magic = CACHE_MAGIC;
+	uint32_t version = CACHE_VERSION;
+	uint32_t event_size = sizeof(MidiEvent);
+	uint32_t byte_order = 0x01020304u;  // Files are not portable across endianness.
+
+	uint64_t hash = 0;
+	uint64_t bpm = BPM_DEFAULT;
+	uint64_t rate = 0;
+	int64_t duration = 0;
+	uint64_t count = 0;
+	uint64_t tempo = 0;  // Tempo points following the events.
+	uint64_t ports = 0;  // Port names following the tempo map.
+};
+
+static_assert(sizeof(CacheHeader) % alignof(MidiEvent) == 0);
+static_assert(sizeof(CacheHeader) % alignof(TempoPoint) == 0);
+static_assert(sizeof(MidiEvent) % alignof(TempoPoint) == 0);
+
+inline uint64_t hash_source(std::string_view src) {
+	return hash_bytes(src.data(), src.data() + src.size()) ^ CACHE_VERSION;
+}
+
+// Write to a temporary file and rename it into place so that a player
+// never maps a partially written timeline.
+inline void save_timeline(const std::filesystem::path& path, const Timeline& tl, uint64_t hash) {
+	CANE_LOG(LogLevel::WRN);
+
+	CacheHeader header {};
+
+	header.hash = hash;
+	header.bpm = tl.bpm;
+	header.rate = tl.rate;
+	header.duration = tl.duration;
+	header.count = tl.size();
+	header.tempo = tl.tempo.size();
+	header.ports = tl.ports.size();
+
+	std::filesystem::path tmp = path;
+	tmp += ".tmp";
+
+	{
+		std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+
+		if (not os.is_open())
+			general_error(STR_FILE_WRITE_ERROR, tmp.string());
+
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		os.write(reinterpret_cast<const char*>(tl.data()), tl.size() * sizeof(MidiEvent));
+		os.write(reinterpret_cast<const char*>(tl.tempo.data()), tl.tempo.size() * sizeof(TempoPoint));
+		os.write(reinterpret_cast<const char*>(tl.ports.data()), tl.ports.size() * sizeof(PortName));
+
+		if (not os.flush())
+			general_error(STR_FILE_WRITE_ERROR, tmp.string());
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmp, path, ec);
+
+	if (ec)
+		general_error(STR_FILE_WRITE_ERROR, path.string());
+}
+
+// Read-only mapping of a saved timeline.
+struct MappedTimeline {
+	const void* addr = nullptr;
+	size_t size = 0;
+	bool ok = false;  // Checked once when mapped, see `check`.
+
+	constexpr MappedTimeline() {}
+
+	inline MappedTimeline(const void* addr_, size_t size_):
+		addr(addr_), size(size_), ok(check()) {}
+
+	MappedTimeline(const MappedTimeline&) = delete;
+	MappedTimeline& operator=(const MappedTimeline&) = delete;
+
+	inline MappedTimeline(MappedTimeline&& other):
+		addr(std::exchange(other.addr, nullptr)), size(std::exchange(other.size, 0)), ok(std::exchange(other.ok, false)) {}
+
+	inline MappedTimeline& operator=(MappedTimeline&& other) {
+		std::swap(addr, other.addr);
+		std::swap(size, other.size);
+		std::swap(ok, other.ok);
+		return *this;
+	}
+
+	inline ~MappedTimeline() {
+		if (addr != nullptr)
+			munmap(const_cast<void*>(addr), size);
+	}
+
+	inline const CacheHeader& header() const {
+		return *static_cast<const CacheHeader*>(addr);
+	}
+
+	inline bool valid() const {
+		return ok;
+	}
+
+	// Check that the file is something we can play, i.e. it was written by
+	// this version of cane on a machine with the same layout. Events are
+	// copied into port buffers as they are so a corrupt or hand edited file
+	// mustn't be able to point outside of them either.
+	inline bool check() const {
+		if (addr == nullptr or size < sizeof(CacheHeader))
+			return false;
+
+		const CacheHeader& h = header();
+		const CacheHeader expected {};
+
+		size_t body = size - sizeof(CacheHeader);
+
+		bool layout =
+			h.magic      == expected.magic and
+			h.version    == expected.version and
+			h.event_size == expected.event_size and
+			h.byte_order == expected.byte_order and
+			h.count <= body / sizeof(MidiEvent) and
+			h.tempo <= body / sizeof(TempoPoint) and
+			h.ports <= PORT_MAX and
+			h.count * sizeof(MidiEvent) + h.tempo * sizeof(TempoPoint) + h.ports * sizeof(PortName) == body;
+
+		if (not layout or h.rate == 0 or h.bpm == 0)
+			return false;
+
+		// Only the default port is opened for a timeline without names.
+		size_t ports = std::max<size_t>(h.ports, 1u);
+		TimelineView tl = view();
+
+		return std::all_of(tl.begin(), tl.end(), [&] (const MidiEvent& ev) {
+			return ev.size <= ev.data.size() and (ev.port == PORT_ALL or ev.port < ports);
+		});
+	}
+
+	inline TimelineView view() const {
+		const CacheHeader& h = header();
+
+		auto first = reinterpret_cast<const MidiEvent*>(static_cast<const char*>(addr) + sizeof(CacheHeader));
+		auto tempo = reinterpret_cast<const TempoPoint*>(first + h.count);
+		auto ports = reinterpret_cast<const PortName*>(tempo + h.tempo);
+
+		return { first, first + h.count, h.duration, h.bpm, h.rate, { tempo, tempo + h.tempo }, { ports, ports + h.ports } };
+	}
+};
+
+inline MappedTimeline map_timeline(const std::filesystem::path& path) {
+	CANE_LOG(LogLevel::WRN);
+
+	int fd = open(path.c_str(), O_RDONLY);
+
+	if (fd == -1)
+		general_error(STR_FILE_READ_ERROR, path.string());
+
+	struct stat st {};
+
+	if (fstat(fd, &st) == -1) {
+		close(fd);
+		general_error(STR_FILE_READ_ERROR, path.string());
+	}
+
+	// Nothing to map, let the caller treat it as invalid.
+	if (st.st_size == 0) {
+		close(fd);
+		return {};
+	}
+
+	int flags = MAP_PRIVATE;
+
+	#ifdef MAP_POPULATE
+		flags |= MAP_POPULATE;  // Fault everything in now rather than during playback.
+	#endif
+
+	void* addr = mmap(nullptr, st.st_size, PROT_READ, flags, fd, 0);
+	close(fd);
+
+	if (addr == MAP_FAILED)
+		general_error(STR_FILE_READ_ERROR, path.string());
+
+	return { addr, static_cast<size_t>(st.st_size) };
+}
+
+}
+
+#endif
@@ -5,30 +5,62 @@
 #include <string_view>
 #include <chrono>
 #include <thread>
+#include <future>
 #include <filesystem>
 #include <memory>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <csignal>
 
-extern "C" {
-	#include <jack/jack.h>
-	#include <jack/midiport.h>
-	#include <jack/ringbuffer.h>
-}
+#include <sys/resource.h>
 
 #include <lib.hpp>
+#include <jack.hpp>
 #include <conflict/conflict.hpp>
 
-struct jack_deleter {
-	template <typename T> constexpr void operator()(T arg) const {
-		jack_free(arg);
-	}
+enum {
+	OPT_HELP      = 0b000001,
+	OPT_LIST      = 0b000010,
+	OPT_STATS     = 0b000100,
+	OPT_TRANSPORT = 0b001000,
+	OPT_LOOP      = 0b010000,
+	OPT_REALTIME  = 0b100000,
 };
 
-using JackPorts = std::unique_ptr<const char*[], jack_deleter>;
+// Set on Ctrl-C so that looping playback can stop cleanly.
+static std::atomic<bool> interrupted { false };
 
-enum {
-	OPT_HELP = 0b001,
-	OPT_LIST = 0b010,
-};
+// Allocation counters for `--stats`. The global allocation functions are
+// replaced so that allocations made by the standard library are seen too.
+// Counted across the process so that the compiler's workers are included,
+// which means JACK setup on the main thread is as well while it overlaps.
+static std::atomic<size_t> alloc_count = 0;
+static std::atomic<size_t> alloc_bytes = 0;
+
+void* operator new(size_t n) {
+	alloc_count.fetch_add(1, std::memory_order_relaxed);
+	alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+
+	if (void* ptr = std::malloc(n == 0 ? 1 : n))
+		return ptr;
+
+	throw std::bad_alloc {};
+}
+
+// GCC sees `free` on memory from `operator new` once these are inlined.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	std::free(ptr);
+}
+
+#pragma GCC diagnostic pop
 
 inline std::string read_file(std::filesystem::path path) {
 	try {
@@ -65,17 +97,418 @@ inline std::string read_file(std::filesystem::path path) {
 	}
 }
 
+inline void print_stats(const cane::Stats& stats, size_t allocs, size_t bytes) {
+	auto ms = [] (cane::Stats::Duration d) {
+		return cane::UnitMillis { d }.count();
+	};
+
+	rusage usage {};
+	getrusage(RUSAGE_SELF, &usage);
+
+	cane::general_notice(cane::STR_STATS_PHASE, cane::STR_STATS_LEXING,    ms(stats.lexing));
+	cane::general_notice(cane::STR_STATS_PHASE, cane::STR_STATS_PARSING,   ms(stats.parsing));
+	cane::general_notice(cane::STR_STATS_PHASE, cane::STR_STATS_COMPILING, ms(stats.compiling));
+	cane::general_notice(cane::STR_STATS_PHASE, cane::STR_STATS_REALTIME,  ms(stats.realtime));
+	cane::general_notice(cane::STR_STATS_PHASE, cane::STR_STATS_SORTING,   ms(stats.sorting));
+	cane::general_notice(cane::STR_STATS_PHASE, cane::STR_STATS_BOOKEND,   ms(stats.bookend));
+	cane::general_notice(cane::STR_STATS_PHASE, cane::STR_STATS_TOTAL,     ms(stats.total));
+
+	cane::general_notice(cane::STR_STATS_TOKENS, stats.tokens);
+	cane::general_notice(cane::STR_STATS_STEPS,  stats.steps);
+	cane::general_notice(cane::STR_STATS_EVENTS, stats.events);
+	cane::general_notice(cane::STR_STATS_ALLOCS, allocs, bytes);
+	cane::general_notice(cane::STR_STATS_MEMORY, usage.ru_maxrss);
+}
+
+inline cane::Timeline compile_source(
+	std::string_view in,
+	const cane::Budget& budget,
+	bool show_stats = false,
+	std::vector<cane::Loop>* loops = nullptr,
+	const std::atomic<bool>* cancel = nullptr
+) {
+	cane::View src { in.data(), in.data() + in.size() };
+
+	cane::Stats stats {};
+
+	size_t allocs = alloc_count;
+	size_t bytes = alloc_bytes;
+
+	cane::Timeline tl;
+
+	// The budget can be set higher than the machine has to give.
+	try {
+		tl = cane::compile(src,
+			[] (cane::Phases phase, cane::View original, cane::View sv, std::string str) {
+				cane::report_error(std::cerr, phase, original, sv, str);
+			},
+			[] (cane::Phases phase, cane::View original, cane::View sv, std::string str) {
+				cane::report_warning(std::cerr, phase, original, sv, str);
+			},
+			[] (cane::Phases phase, cane::View original, cane::View sv, std::string str) {
+				cane::report_notice(std::cerr, phase, original, sv, str);
+			},
+			show_stats ? &stats : nullptr,
+			loops,
+			cancel,
+			budget
+		);
+	}
+
+	catch (const std::bad_alloc&) {
+		cane::general_error(cane::STR_NO_MEMORY);
+	}
+
+	if (show_stats)
+		print_stats(stats, alloc_count - allocs, alloc_bytes - bytes);
+
+	return tl;
+}
+
+inline cane::Timeline compile_file(std::string_view filename, const cane::Budget& budget, bool show_stats = false) {
+	if (filename.empty())
+		cane::general_error(cane::STR_OPT_NO_FILE);
+
+	return compile_source(read_file(filename), budget, show_stats);
+}
+
+// Everything playback needs from the source and cache.
+struct Source {
+	std::string in;
+	cane::Timeline compiled;
+	cane::MappedTimeline mapped;
+	std::vector<cane::Loop> loops;
+
+	inline cane::TimelineView view() const {
+		return mapped.valid() ? mapped.view() : cane::TimelineView { compiled };
+	}
+};
+
+// A precompiled timeline is used as-is when there is no source to check
+// it against, otherwise only if it was built from this exact source. Stale
+// timelines are recompiled and replaced. Loops are kept from the source, a
+// cached timeline has none.
+inline Source load_source(
+	std::string_view filename,
+	std::string_view cache,
+	const cane::Budget& budget,
+	bool looping,
+	bool show_stats,
+	const std::atomic<bool>& cancel
+) {
+	Source src;
+
+	if (looping) {
+		if (filename.empty())
+			cane::general_error(cane::STR_OPT_NO_FILE);
+
+		src.in = read_file(filename);
+		src.compiled = compile_source(src.in, budget, show_stats, &src.loops, &cancel);
+
+		return src;
+	}
+
+	if (not cache.empty() and std::filesystem::exists(cache))
+		src.mapped = cane::map_timeline(cache);
+
+	if (filename.empty()) {
+		if (cache.empty())
+			cane::general_error(cane::STR_OPT_NO_FILE);
+
+		if (not src.mapped.valid())
+			cane::general_error(cane::STR_CACHE_INVALID, cache);
+	}
+
+	else {
+		src.in = read_file(filename);
+		uint64_t hash = cane::hash_source(src.in);
+
+		if (not src.mapped.valid() or src.mapped.header().hash != hash) {
+			src.mapped = {};
+			src.compiled = compile_source(src.in, budget, show_stats, nullptr, &cancel);
+
+			if (not cache.empty())
+				cane::save_timeline(cache, src.compiled, hash);
+		}
+	}
+
+	return src;
+}
+
+inline void render_file(const cane::Timeline& timeline, std::filesystem::path path) {
+	std::ofstream os(path, std::ios::binary);
+
+	if (not os.is_open())
+		cane::general_error(cane::STR_FILE_WRITE_ERROR, path.string());
+
+	if (not cane::render_smf(os, timeline).flush())
+		cane::general_error(cane::STR_FILE_WRITE_ERROR, path.string());
+}
+
+// Warn about any period that needs more room than the port buffer has.
+// Overflows are attributed to the sends that contributed to them when the
+// source is at hand, a cached timeline can only report times.
+inline void check_capacity(
+	cane::TimelineView timeline,
+	const cane::Timeline& compiled,
+	std::string_view in,
+	uint64_t frames,
+	uint64_t sample_rate,
+	size_t buffer_bytes,
+	bool show_stats
+) {
+	cane::View src { in.data(), in.data() + in.size() };
+	cane::CapacityReport report = cane::capacity_analysis(timeline, frames, sample_rate, buffer_bytes);
+
+	auto secs = [] (cane::UnitSeconds t) {
+		return std::max(t, cane::UnitSeconds::zero()).count();
+	};
+
+	if (show_stats)
+		cane::general_notice(cane::STR_CAPACITY_PEAK,
+			report.peak.events, report.peak.bytes, report.capacity, secs(report.peak.end));
+
+	size_t n = 0;
+
+	for (const cane::Window& w: report.overflows) {
+		if (n++ == cane::CAPACITY_REPORT_MAX) {
+			cane::general_warning(cane::STR_CAPACITY_MORE, report.overflows.size() - cane::CAPACITY_REPORT_MAX);
+			break;
+		}
+
+		std::ostringstream ss;
+		cane::fmt(ss, cane::STR_CAPACITY, w.events, w.bytes, secs(w.begin), secs(w.end), report.capacity);
+
+		bool attributed = false;
+
+		cane::capacity_origins(compiled, w, [&] (const cane::Origin& origin) {
+			cane::report_warning(std::cerr, cane::Phases::SEMANTIC, src, origin.view, ss.str());
+			attributed = true;
+		});
+
+		if (not attributed)
+			cane::general_warning(cane::STR_CAPACITY, w.events, w.bytes, secs(w.begin), secs(w.end), report.capacity);
+	}
+}
+
+// Which destinations an output port connects to. `-m` takes a comma
+// separated list of `port=pattern` routes, each connecting the port to
+// every destination matching the pattern. A bare pattern connects the
+// default port to the first match.
+struct Route {
+	std::string_view port;
+	std::string pattern;
+	bool fan_out = false;
+};
+
+inline std::vector<Route> parse_routes(std::string_view device) {
+	std::vector<Route> routes;
+
+	while (true) {
+		std::string_view entry = device.substr(0, device.find(','));
+
+		if (size_t eq = entry.find('='); eq != std::string_view::npos)
+			routes.push_back({ entry.substr(0, eq), std::string { entry.substr(eq + 1) }, true });
+
+		else
+			routes.push_back({ cane::CSTR_PORT, std::string { entry }, false });
+
+		if (entry.size() == device.size())
+			break;
+
+		device.remove_prefix(entry.size() + 1);
+	}
+
+	return routes;
+}
+
+// Decimal number `sv` taken from option `opt`'s argument `arg`. Anything
+// that isn't a number or is larger than `max` is an error.
+inline size_t parse_number(std::string_view opt, std::string_view arg, std::string_view sv, size_t max = std::numeric_limits<size_t>::max()) {
+	if (sv.empty())
+		cane::general_error(cane::STR_OPT_INVALID_ARG, arg, opt);
+
+	size_t n = 0;
+
+	for (char c: sv) {
+		size_t digit = c - '0';
+
+		if (c < '0' or c > '9' or n > (max - digit) / 10)
+			cane::general_error(cane::STR_OPT_INVALID_ARG, arg, opt);
+
+		n = n * 10 + digit;
+	}
+
+	return n;
+}
+
+// Scheduling for a helper thread given as `class[:priority][@cpu,...]`
+// where the class is one of `other`, `batch`, `idle`, `fifo` or `rr`.
+// Either half may be left out, i.e. `fifo:40` or `@2,3`.
+inline cane::ThreadPolicy parse_policy(std::string_view opt, std::string_view arg) {
+	cane::ThreadPolicy p;
+
+	if (arg.empty())
+		return p;
+
+	std::string_view sched = arg.substr(0, arg.find('@'));
+	std::string_view cpus = sched.size() == arg.size() ? std::string_view {} : arg.substr(sched.size() + 1);
+
+	if (not sched.empty()) {
+		std::string_view name = sched.substr(0, sched.find(':'));
+
+		if      (name == "other") p.policy = SCHED_OTHER;
+		else if (name == "batch") p.policy = SCHED_BATCH;
+		else if (name == "idle")  p.policy = SCHED_IDLE;
+		else if (name == "fifo")  p.policy = SCHED_FIFO;
+		else if (name == "rr")    p.policy = SCHED_RR;
+		else cane::general_error(cane::STR_OPT_INVALID_ARG, arg, opt);
+
+		p.priority = name.size() != sched.size() ?
+			parse_number(opt, arg, sched.substr(name.size() + 1), std::numeric_limits<int>::max()) :
+			sched_get_priority_min(*p.policy);
+	}
+
+	while (not cpus.empty()) {
+		std::string_view cpu = cpus.substr(0, cpus.find(','));
+		p.cpus.push_back(parse_number(opt, arg, cpu));
+
+		cpus.remove_prefix(std::min(cpu.size() + 1, cpus.size()));
+	}
+
+	return p;
+}
+
+// Compile budget given as `bytes[k|m|g][:events]`, i.e. `512m:10000000`.
+// Either half may be left out to keep its default.
+inline cane::Budget parse_budget(std::string_view opt, std::string_view arg) {
+	cane::Budget b;
+
+	std::string_view memory = arg.substr(0, arg.find(':'));
+	std::string_view events = memory.size() == arg.size() ? std::string_view {} : arg.substr(memory.size() + 1);
+
+	if (not memory.empty()) {
+		size_t shift = 0;
+
+		switch (memory.back()) {
+			case 'k': case 'K': shift = 10; break;
+			case 'm': case 'M': shift = 20; break;
+			case 'g': case 'G': shift = 30; break;
+			default: break;
+		}
+
+		if (shift != 0)
+			memory.remove_suffix(1);
+
+		b.memory = parse_number(opt, arg, memory, std::numeric_limits<size_t>::max() >> shift) << shift;
+	}
+
+	if (not events.empty())
+		b.events = parse_number(opt, arg, events);
+
+	return b;
+}
+
+// `period` is the callback's deadline. It's taken as floating point seconds
+// since a period is well under a second and would truncate to nothing.
+inline void print_player_stats(const cane::PlayerStats& stats, cane::UnitSeconds period) {
+	auto us = [] (uint64_t ns) {
+		return static_cast<double>(ns) / 1000.0;
+	};
+
+	auto& cb = stats.callback;
+	auto& ev = stats.events;
+
+	cane::general_notice(cane::STR_HISTOGRAM, cane::STR_HISTOGRAM_CALLBACK,
+		us(cb.percentile(50.0)), us(cb.percentile(90.0)), us(cb.percentile(99.0)),
+		us(cb.percentile(99.9)), us(cb.max), cb.count);
+
+	cane::general_notice(cane::STR_HISTOGRAM, cane::STR_HISTOGRAM_EVENTS,
+		ev.percentile(50.0), ev.percentile(90.0), ev.percentile(99.0),
+		ev.percentile(99.9), ev.max.load(), ev.count);
+
+	cane::general_notice(cane::STR_PLAYER_SUMMARY, stats.xruns, stats.lost, stats.underruns, cane::UnitMicros { period }.count());
+	cane::general_notice(cane::STR_SPILL_SUMMARY, stats.spilled, stats.dropped, stats.cancelled);
+}
+
+// One JSON object per line so the file can be tailed during a set.
+inline void stream_player_stats(std::ostream& os, const cane::PlayerStats& stats, double elapsed) {
+	auto& cb = stats.callback;
+	auto& ev = stats.events;
+
+	cane::println(os,
+		"{ \"elapsed\": ", elapsed,
+		", \"cycles\": ", cb.count,
+		", \"xruns\": ", stats.xruns,
+		", \"lost\": ", stats.lost,
+		", \"underruns\": ", stats.underruns,
+		", \"spilled\": ", stats.spilled,
+		", \"dropped\": ", stats.dropped,
+		", \"callback_ns\": { \"p50\": ", cb.percentile(50.0), ", \"p99\": ", cb.percentile(99.0), ", \"p999\": ", cb.percentile(99.9), ", \"max\": ", cb.max, " }",
+		", \"events\": { \"p50\": ", ev.percentile(50.0), ", \"p99\": ", ev.percentile(99.0), ", \"max\": ", ev.max, " } }"
+	);
+
+	os.flush();
+}
+
+// Starts recording on construction and writes the trace on destruction.
+struct TraceFile {
+	std::filesystem::path path;
+
+	inline TraceFile(std::string_view path_): path(path_) {
+		if (path.empty())
+			return;
+
+		if (not cane::TRACE_AVAILABLE) {
+			cane::general_warning(cane::STR_TRACE_DISABLED);
+			path.clear();
+			return;
+		}
+
+		cane::trace_register_thread("main"_sv);
+		cane::trace_start();
+	}
+
+	inline ~TraceFile() {
+		if (path.empty())
+			return;
+
+		std::ofstream os(path);
+
+		if (not os.is_open() or not cane::trace_write(os).flush())
+			cane::general_warning(cane::STR_FILE_WRITE_ERROR, path.string());
+	}
+};
+
 int main(int argc, const char* argv[]) {
 	std::string_view device;
 	std::string_view filename;
+	std::string_view render;
+	std::string_view cache;
+	std::string_view trace;
+	std::string_view stats_path;
+	std::string_view compile_policy;
+	std::string_view render_policy;
+	std::string_view budget_arg;
 	uint64_t flags;
 
 	auto parser = conflict::parser {
 		conflict::option { { 'h', "help", "show help" }, flags, OPT_HELP },
 		conflict::option { { 'l', "list", "list available midi devices" }, flags, OPT_LIST },
+		conflict::option { { 's', "stats", "print compilation statistics" }, flags, OPT_STATS },
+		conflict::option { { 'T', "transport", "follow jack transport" }, flags, OPT_TRANSPORT },
+		conflict::option { { 'L', "loop", "loop every send independently until interrupted" }, flags, OPT_LOOP },
+		conflict::option { { 'R', "realtime", "lock playback into memory before starting" }, flags, OPT_REALTIME },
 
 		conflict::string_option { { 'f', "file", "input file" }, "filename", filename },
-		conflict::string_option { { 'm', "midi", "midi device to connect to" }, "device", device }
+		conflict::string_option { { 'm', "midi", "midi device to connect to or port=device routes" }, "device", device },
+		conflict::string_option { { 'r', "render", "render to a standard midi file" }, "filename", render },
+		conflict::string_option { { 'c', "cache", "precompiled timeline to play or update" }, "filename", cache },
+		conflict::string_option { { 't', "trace", "write a chrome trace of compilation and playback" }, "filename", trace },
+		conflict::string_option { { 'S', "stats-file", "stream playback statistics to a file" }, "filename", stats_path },
+		conflict::string_option { { 'C', "compile-policy", "scheduling of the compiler thread" }, "class[:prio][@cpus]", compile_policy },
+		conflict::string_option { { 'P', "render-policy", "scheduling of the render thread" }, "class[:prio][@cpus]", render_policy },
+		conflict::string_option { { 'B', "budget", "most memory and events a song may compile to" }, "bytes[k|m|g][:events]", budget_arg }
 	};
 
 	parser.apply_defaults();
@@ -102,171 +535,201 @@ int main(int argc, const char* argv[]) {
 			return 0;
 		}
 
-		// Setup JACK
-		using namespace std::chrono_literals;
+		cane::Budget budget = parse_budget("budget", budget_arg);
+
+		// Written out however we leave main.
+		TraceFile trace_file { trace };
+
+		// Render straight to a file, JACK is not needed at all here.
+		if (not render.empty()) {
+			cane::Timeline timeline = compile_file(filename, budget, flags & OPT_STATS);
+			render_file(timeline, render);
 
-		struct JackData {
-			jack_client_t* client = nullptr;
-			jack_port_t* port = nullptr;
+			return 0;
+		}
+
+		// If no device is specified _and_ `-l` is not passed,
+		// throw an error. It's perfectly valid to give an empty
+		// string to JACK here and it will give us back a list
+		// of ports regardless.
+		if (device.empty() and (flags & OPT_LIST) != OPT_LIST)
+			cane::general_error(cane::STR_NO_DEVICE);
+
+
+		// Compiler
+		// Runs alongside JACK setup so that starting up only takes as long
+		// as the slower of the two. Anything going wrong on this side sets
+		// `cancel` on the way out so we don't wait on a full compile.
+		std::atomic<bool> cancel = false;
+		std::future<Source> loading;
 
-			jack_nframes_t sample_rate = 0;
-			jack_nframes_t buffer_size = 0;
-			cane::Unit time = cane::Unit::zero();
+		cane::ThreadPolicy compiler = parse_policy("compile-policy", compile_policy);
+		cane::ThreadPolicy renderer = parse_policy("render-policy", render_policy);
 
-			cane::Timeline::iterator it;
-			cane::Timeline::const_iterator end;
+		if (not (flags & OPT_LIST)) {
+			loading = std::async(std::launch::async, [&] {
+				if (cane::trace_enabled())
+					cane::trace_register_thread("compile"_sv);
 
-			cane::Timeline events;
+				if (not compiler.empty() and not cane::thread_policy_apply(compiler))
+					cane::general_warning(cane::STR_THREAD_POLICY, "compile"_sv);
 
-			~JackData() {
-				if (client != nullptr)
-					jack_deactivate(client);
+				return load_source(filename, cache, budget, flags & OPT_LOOP, flags & OPT_STATS, cancel);
+			});
+		}
 
-				if (port != nullptr)
-					jack_port_unregister(client, port);
+		struct Cancel {
+			std::atomic<bool>& cancel;
 
-				if (client != nullptr)
-					jack_client_close(client);
+			inline ~Cancel() {
+				cancel.store(true, std::memory_order_relaxed);
 			}
-		} midi {};
+		} cancel_on_exit { cancel };
 
 
-		// Connect to JACK
-		if (not (midi.client = jack_client_open(cane::CSTR_EXE, JackOptions::JackNoStartServer, nullptr)))
-			cane::general_error(cane::STR_CONNECT_ERROR);
+		// Setup JACK
+		using namespace std::chrono_literals;
 
+		cane::Player player;
+		cane::JackBackend jack { player };
 
-		// Sample rate changed callback. We use the sample rate to determine timing
-		// information so this is crucial.
-		if (jack_set_sample_rate_callback(midi.client, [] (jack_nframes_t sample_rate, void* arg) {
-			JackData& midi = *static_cast<JackData*>(arg);
-			midi.sample_rate = sample_rate;
-			return 0;
-		}, static_cast<void*>(&midi)))
-			cane::general_error(cane::STR_SAMPLE_RATE_CALLBACK_ERROR);
+		// The render thread only has to keep ahead of the callback, it
+		// should never be able to preempt it. The compiler is done before
+		// the client is activated.
+		if (int ceiling = jack.priority(); ceiling != 0 and cane::thread_policy_cap(renderer, ceiling))
+			cane::general_warning(cane::STR_THREAD_PRIORITY, "render"_sv, renderer.priority, ceiling);
 
+		player.render_policy = renderer;
+
+
+		// Print all devices if list option passed
+		if (flags & OPT_LIST) {
+			cane::JackPorts ports = jack.destinations(std::string { device });
+
+			for (size_t i = 0; ports[i] != nullptr; ++i)
+				cane::general_notice(cane::STR_DEVICE, ports[i]);
 
-		// Notify of buffer size changes
-		if (jack_set_buffer_size_callback(midi.client, [] (jack_nframes_t buffer_size, void* arg) {
-			JackData& midi = *static_cast<JackData*>(arg);
-			midi.buffer_size = buffer_size;
 			return 0;
-		}, static_cast<void*>(&midi)))
-			cane::general_error(cane::STR_BUFFER_SIZE_CALLBACK_ERROR);
+		}
+
 
-		// MIDI out callback
-		if (jack_set_process_callback(midi.client, [] (jack_nframes_t nframes, void *arg) {
-			auto& [client, port, sample_rate, buffer_size, time, it, end, events] = *static_cast<JackData*>(arg);
+		// Register and connect every port that is routed somewhere while
+		// still compiling so that failing here cancels the compile. Ports
+		// are put in the order the timeline uses once it's done.
+		std::vector<Route> routes = parse_routes(device);
 
-			void* out_buffer = jack_port_get_buffer(port, nframes);
-			jack_midi_clear_buffer(out_buffer);
+		for (const Route& route: routes) {
+			cane::JackPorts ports = jack.destinations(route.pattern);
+			size_t port = jack.declare(cane::port_name({ route.port.data(), route.port.data() + route.port.size() }));
 
-			// Copy every MIDI event into the buffer provided by JACK.
-			for (; it != end and it->time <= time; ++it) {
-				if (jack_midi_event_write(out_buffer, 0, it->data.data(), it->data.size()))
-					cane::general_error(cane::STR_WRITE_ERROR);
+			for (size_t i = 0; ports[i] != nullptr; ++i) {
+				jack.connect(port, ports[i]);
+
+				if (not route.fan_out)
+					break;
 			}
+		}
+
+		Source src = loading.get();
 
-			size_t lost = 0;
-			if ((lost = jack_midi_get_lost_event_count(out_buffer)))
-				cane::general_warning(cane::STR_LOST_EVENT, lost);
+		if (flags & OPT_LOOP) {
+			player.loop(std::move(src.loops), src.compiled.bpm);
 
-			time += std::chrono::duration_cast<cane::Unit>(std::chrono::seconds { nframes }) / sample_rate;
+			if (player.looper.loops.empty())
+				return 0;
+		}
+
+		cane::TimelineView timeline = src.view();
 
+		if (timeline.empty() and not player.looping)
 			return 0;
-		}, static_cast<void*>(&midi)))
-			cane::general_error(cane::STR_PROCESS_CALLBACK_ERROR);
 
+		// Register a port for each one the timeline uses. A timeline with
+		// no names only has the default port.
+		std::vector<cane::PortName> names { timeline.ports.begin(), timeline.ports.end() };
 
-		// If no device is specified _and_ `-l` is not passed,
-		// throw an error. It's perfectly valid to give an empty
-		// string to JACK here and it will give us back a list
-		// of ports regardless.
-		if (device.empty() and (flags & OPT_LIST) != OPT_LIST)
-			cane::general_error(cane::STR_NO_DEVICE);
+		if (names.empty())
+			names.push_back(cane::port_name(cane::CSTR_PORT));
+
+		for (cane::PortName& name: names)
+			name.back() = '\0';  // Names from a mapped timeline are not trusted.
 
+		// Every routed port has to be one the timeline uses.
+		for (const Route& route: routes) {
+			auto it = std::find_if(names.begin(), names.end(), [&] (const cane::PortName& name) {
+				return route.port == name.data();
+			});
 
-		// Register port and get information.
-		if (not (midi.port = jack_port_register(midi.client, cane::CSTR_PORT, JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0)))
-			cane::general_error(cane::STR_PORT_ERROR);
+			if (it == names.end())
+				cane::general_error(cane::STR_PORT_UNDECLARED, route.port);
+		}
 
-		midi.buffer_size = jack_get_buffer_size(midi.client);
-		midi.sample_rate = jack_get_sample_rate(midi.client);
+		jack.open(names);
 
+		CANE_DBG_RUN(cane::print(std::cerr, timeline));
+		CANE_LOG(cane::LogLevel::DBG, "event(s) = ", timeline.size());
+		CANE_LOG(cane::LogLevel::DBG, "events/s = ", timeline.size() / cane::timeline_seconds(timeline, timeline.duration).count());
 
-		// Get an array of all MIDI input ports that we could potentially connect to.
-		JackPorts ports { jack_get_ports(midi.client, std::string { device }.c_str(), JACK_DEFAULT_MIDI_TYPE, JackPortIsInput) };
+		// Catch periods that won't fit in the port buffer before playback.
+		if (not player.looping)
+			check_capacity(timeline, src.compiled, src.in,
+				player.buffer_size, player.sample_rate,
+				jack.buffer_bytes(),
+				flags & OPT_STATS);
 
-		if (not ports)  // Error occured
-			cane::general_error(cane::STR_GET_PORTS_ERROR);
+		if (flags & OPT_TRANSPORT)
+			player.follow_transport(timeline);
 
-		if (not ports[0])  // No MIDI input ports.
-			cane::general_error(cane::STR_NOT_FOUND, device);
+		// Setup MIDI events.
+		if (not player.looping)
+			player.play(timeline);
 
-		// Print all devices if list option passed
-		if (flags & OPT_LIST) {
-			for (size_t i = 0; ports[i] != nullptr; ++i)
-				cane::general_notice(cane::STR_DEVICE, ports[i]);
+		// Nothing the callback touches should be able to page-fault.
+		if ((flags & OPT_REALTIME) and not player.lock_memory())
+			cane::general_warning(cane::STR_MLOCK_ERROR);
 
-			return 0;
+		jack.activate();
+
+		std::ofstream stats_file;
+
+		if (not stats_path.empty()) {
+			stats_file.open(std::filesystem::path { stats_path });
+
+			if (not stats_file.is_open())
+				cane::general_error(cane::STR_FILE_WRITE_ERROR, stats_path);
 		}
 
-		if (jack_connect(midi.client, jack_port_name(midi.port), ports[0]))
-			cane::general_error(cane::STR_PATCH_ERROR);
+		// Loop until interrupted, then give the callback a chance to
+		// release any held notes before we disconnect.
+		if (player.looping) {
+			std::signal(SIGINT, [] (int) { interrupted.store(true); });
 
+			auto begin = std::chrono::steady_clock::now();
+			std::cout << std::fixed << std::setprecision(2);
 
-		// Compiler
-		if (filename.empty())
-			cane::general_error(cane::STR_OPT_NO_FILE);
+			while (not interrupted.load()) {
+				auto so_far = cane::UnitSeconds { std::chrono::steady_clock::now() - begin }.count();
 
-		std::string in = read_file(filename);
-		cane::View src { &*in.begin(), &*in.end() };
-
-		namespace time = std::chrono;
-
-		using clock = time::steady_clock;
-		using unit = time::microseconds;
-
-		// Compile
-		auto t1 = clock::now();
-			cane::Timeline timeline = cane::compile(src,
-				[] (cane::Phases phase, cane::View original, cane::View sv, std::string str) {
-					cane::report_error(std::cerr, phase, original, sv, str);
-				},
-				[] (cane::Phases phase, cane::View original, cane::View sv, std::string str) {
-					cane::report_warning(std::cerr, phase, original, sv, str);
-				},
-				[] (cane::Phases phase, cane::View original, cane::View sv, std::string str) {
-					cane::report_notice(std::cerr, phase, original, sv, str);
-				}
-			);
-		auto t2 = clock::now();
-
-		if (timeline.empty())
-			return 0;
+				cane::print(std::cout, "\r", CANE_BOLD, cane::STR_LOOPING, " ", so_far, "s" CANE_RESET);
+				std::cout.flush();
 
-		CANE_DBG_RUN(cane::print(std::cerr, timeline));
-		CANE_LOG(cane::LogLevel::DBG, "event(s) = ", timeline.size());
-		CANE_LOG(cane::LogLevel::DBG, "events/s = ", timeline.size() / cane::UnitSeconds{timeline.duration}.count());
+				if (stats_file.is_open())
+					stream_player_stats(stats_file, player.stats, so_far);
 
-		// Setup MIDI events.
-		// Very important that we assign these here or else
-		// the sequencer will not run, or worse- start
-		// sequencing garbage values.
-		midi.events = timeline;
+				std::this_thread::sleep_for(100ms);
+			}
 
-		midi.it = timeline.begin();
-		midi.end = timeline.cend();
+			player.stop();
 
-		// Call this or else our callback is never called.
-		if (jack_activate(midi.client))
-			cane::general_error(cane::STR_ACTIVATE_ERROR);
+			while (not player.done.load(std::memory_order_acquire))
+				std::this_thread::sleep_for(cane::frame_time(player.buffer_size, player.sample_rate));
+		}
 
 		// Sleep until timeline is completed.
 		size_t count = 1;
 		size_t barw = 50;
 
-		while (midi.it != midi.end) {
+		while (not player.done.load(std::memory_order_acquire)) {
 			cane::print(std::cout, "\r", CANE_BOLD, count, "% [");
 
 			for (size_t i = 0; i != barw; ++i) {
@@ -277,18 +740,25 @@ int main(int argc, const char* argv[]) {
 				else                cane::print(std::cout, CANE_BLUE   "-");
 			}
 
-			auto so_far = cane::UnitSeconds{(timeline.duration / 100) * count}.count();
-			auto total = cane::UnitSeconds{timeline.duration}.count();
+			auto total = cane::timeline_seconds(timeline, timeline.duration).count();
+			auto so_far = total / 100 * count;
 
 			std::cout << std::fixed << std::setprecision(2);
 			cane::print(std::cout, CANE_RESET CANE_BOLD "] ", so_far, "s/", total, "s" CANE_RESET);
 			std::cout.flush();
 
+			if (stats_file.is_open())
+				stream_player_stats(stats_file, player.stats, so_far);
+
 			count++;
-			std::this_thread::sleep_for(timeline.duration / 100);
+			std::this_thread::sleep_for(cane::timeline_seconds(timeline, timeline.duration) / 100);
 		}
 
 		cane::println(std::cout);
+
+		if (flags & OPT_STATS) {
+			print_player_stats(player.stats, cane::frame_time(player.buffer_size, player.sample_rate));
+		}
 	}
 
 	catch (cane::Error) {
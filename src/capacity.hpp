@@ -0,0 +1,130 @@
+#ifndef CANE_CAPACITY_HPP
+#define CANE_CAPACITY_HPP
+
+namespace cane {
+
+// Port buffer capacity.
+// Every JACK period the player writes all events that have become due into
+// a MIDI port buffer of fixed size. Since the timeline is known up front we
+// can replay the exact windows the process callback will see and find any
+// period that needs more room than the buffer has, before playback starts.
+
+// JACK stores a small header per buffer and a fixed size record per event
+// with up to 4 bytes of data inline. These are the larger of the JACK1 and
+// JACK2 layouts so estimates err on the side of warning.
+constexpr size_t JACK_MIDI_HEADER_SIZE = 32u;
+constexpr size_t JACK_MIDI_EVENT_SIZE  = 12u;
+constexpr size_t JACK_MIDI_INLINE_SIZE = 4u;
+
+constexpr size_t CAPACITY_REPORT_MAX = 8u;  // Overflowing windows reported in full.
+
+constexpr size_t event_footprint(size_t size) {
+	return JACK_MIDI_EVENT_SIZE + (size > JACK_MIDI_INLINE_SIZE ? size : 0u);
+}
+
+// Every port has a buffer of its own so figures are for the busiest one.
+struct Window {
+	UnitSeconds begin = UnitSeconds::zero();
+	UnitSeconds end   = UnitSeconds::zero();
+
+	size_t events = 0;  // Peak within the window.
+	size_t bytes  = 0;
+};
+
+struct CapacityReport {
+	size_t capacity = 0;  // Usable bytes per period.
+
+	Window peak;  // Busiest single period.
+	std::vector<Window> overflows;  // Runs of consecutive periods over capacity.
+};
+
+// Period `k` of the player writes every event due in frames
+// `[k * frames, (k + 1) * frames)`, the same slices `bucket_fill` makes.
+inline CapacityReport capacity_analysis(TimelineView tl, uint64_t frames, uint64_t sample_rate, size_t buffer_bytes) {
+	CANE_LOG(LogLevel::INF);
+
+	CapacityReport report {};
+	report.capacity = buffer_bytes > JACK_MIDI_HEADER_SIZE ? buffer_bytes - JACK_MIDI_HEADER_SIZE : 0u;
+
+	if (tl.empty() or frames == 0 or sample_rate == 0)
+		return report;
+
+	auto index = [&] (Tick t) -> uint64_t {
+		return event_frame(t, tl, sample_rate) / frames;
+	};
+
+	bool in_run = false;
+	uint64_t last = 0;
+
+	size_t nports = std::clamp<size_t>(tl.ports.size(), 1u, PORT_MAX);
+
+	const MidiEvent* it = tl.begin();
+
+	while (it != tl.end()) {
+		uint64_t k = index(it->time);
+
+		Window current {
+			frame_time(k * frames, sample_rate),
+			frame_time((k + 1) * frames, sample_rate),
+			0u, 0u
+		};
+
+		std::array<size_t, PORT_MAX> events {};
+		std::array<size_t, PORT_MAX> bytes {};
+
+		for (; it != tl.end() and index(it->time) == k; ++it) {
+			size_t from = it->port == PORT_ALL ? 0u : it->port % PORT_MAX;
+			size_t to = it->port == PORT_ALL ? nports : from + 1u;
+
+			for (size_t port = from; port != to; ++port) {
+				events[port]++;
+				bytes[port] += event_footprint(it->size);
+			}
+		}
+
+		current.events = *std::max_element(events.begin(), events.end());
+		current.bytes = *std::max_element(bytes.begin(), bytes.end());
+
+		if (current.bytes > report.peak.bytes)
+			report.peak = current;
+
+		// A run only continues into the very next period.
+		if (current.bytes <= report.capacity or k != last + 1)
+			in_run = false;
+
+		if (current.bytes > report.capacity) {
+			if (in_run) {
+				Window& run = report.overflows.back();
+
+				run.end = current.end;
+				run.events = std::max(run.events, current.events);
+				run.bytes = std::max(run.bytes, current.bytes);
+			}
+
+			else
+				report.overflows.push_back(current);
+
+			in_run = true;
+		}
+
+		last = k;
+	}
+
+	return report;
+}
+
+// Sends which contributed to a window.
+template <typename F>
+inline void capacity_origins(const Timeline& tl, const Window& w, F&& fn) {
+	for (const Origin& origin: tl.origins) {
+		UnitSeconds begin = timeline_seconds(tl, origin.begin);
+		UnitSeconds end = timeline_seconds(tl, origin.end);
+
+		if (begin <= w.end and end > w.begin)
+			fn(origin);
+	}
+}
+
+}
+
+#endif
@@ -54,6 +54,9 @@ constexpr bool is_sequence_infix(Token x) {
 		Symbols::OR,
 		Symbols::AND,
 		Symbols::XOR,
+		Symbols::POLY_OR,
+		Symbols::POLY_AND,
+		Symbols::POLY_XOR,
 		Symbols::CAT,
 		Symbols::ROTL,
 		Symbols::ROTR,
@@ -95,9 +98,9 @@ enum class OpFix {
 	SEQ_POSTFIX,
 };
 
-inline std::pair<size_t, size_t> binding_power(Context& ctx, Lexer& lx, Token tok, OpFix fix) {
-	auto [view, kind] = tok;
-
+// Left and right binding power of an operator, zero for both if `kind`
+// isn't an operator of that fixity.
+constexpr std::pair<size_t, size_t> binding_power(Symbols kind, OpFix fix) {
 	enum { LEFT = 1, RIGHT = 0, };
 
 	enum {
@@ -109,13 +112,16 @@ inline std::pair<size_t, size_t> binding_power(Context& ctx, Lexer& lx, Token to
 		CDR = CAR,
 
 		CAT,
-		OR   = CAT,
-		AND  = CAT,
-		XOR  = CAT,
-		ROTL = CAT,
-		ROTR = CAT,
-		REP  = CAT,
-		BPM  = CAT,
+		OR       = CAT,
+		AND      = CAT,
+		XOR      = CAT,
+		POLY_OR  = CAT,
+		POLY_AND = CAT,
+		POLY_XOR = CAT,
+		ROTL     = CAT,
+		ROTR     = CAT,
+		REP      = CAT,
+		BPM      = CAT,
 
 		REV,
 		INVERT = REV,
@@ -154,16 +160,19 @@ inline std::pair<size_t, size_t> binding_power(Context& ctx, Lexer& lx, Token to
 		} break;
 
 		case OpFix::SEQ_INFIX: switch (kind) {
-			case Symbols::MAP:   return { MAP,   MAP   + LEFT };
-			case Symbols::CHAIN: return { CHAIN, CHAIN + LEFT };
-			case Symbols::CAT:   return { CAT,   CAT   + LEFT };
-			case Symbols::OR:    return { OR,    OR    + LEFT };
-			case Symbols::AND:   return { AND,   AND   + LEFT };
-			case Symbols::XOR:   return { XOR,   XOR   + LEFT };
-			case Symbols::REP:   return { REP,   REP   + LEFT };
-			case Symbols::ROTL:  return { ROTL,  ROTL  + LEFT };
-			case Symbols::ROTR:  return { ROTR,  ROTR  + LEFT };
-			case Symbols::BPM:   return { BPM,   BPM   + LEFT };
+			case Symbols::MAP:      return { MAP,      MAP      + LEFT };
+			case Symbols::CHAIN:    return { CHAIN,    CHAIN    + LEFT };
+			case Symbols::CAT:      return { CAT,      CAT      + LEFT };
+			case Symbols::OR:       return { OR,       OR       + LEFT };
+			case Symbols::AND:      return { AND,      AND      + LEFT };
+			case Symbols::XOR:      return { XOR,      XOR      + LEFT };
+			case Symbols::POLY_OR:  return { POLY_OR,  POLY_OR  + LEFT };
+			case Symbols::POLY_AND: return { POLY_AND, POLY_AND + LEFT };
+			case Symbols::POLY_XOR: return { POLY_XOR, POLY_XOR + LEFT };
+			case Symbols::REP:      return { REP,      REP      + LEFT };
+			case Symbols::ROTL:     return { ROTL,     ROTL     + LEFT };
+			case Symbols::ROTR:     return { ROTR,     ROTR     + LEFT };
+			case Symbols::BPM:      return { BPM,      BPM      + LEFT };
 			default: break;
 		} break;
 
@@ -175,9 +184,140 @@ inline std::pair<size_t, size_t> binding_power(Context& ctx, Lexer& lx, Token to
 		} break;
 	}
 
+	return { 0u, 0u };
+}
+
+inline std::pair<size_t, size_t> binding_power(Context& ctx, Lexer& lx, Token tok, OpFix fix) {
+	auto [view, kind] = tok;
+
+	if (auto bp = binding_power(kind, fix); bp != std::pair<size_t, size_t> {})
+		return bp;
+
 	lx.error(ctx, Phases::INTERNAL, view, STR_UNREACHABLE, sym2str(kind));
 }
 
+// Realtime and bookend
+// Events placed around everything that was sent. `static_compile` builds
+// its timeline from these same helpers so the two can't disagree.
+constexpr size_t BOOKEND_EVENTS = (CHANNEL_MAX - CHANNEL_MIN) * 3 + 2;
+
+// Active sensing in `[0, duration)` on a timeline without tempo changes.
+template <typename F>
+constexpr void realtime_sensing(Tick duration, Rate rate, F&& emit) {
+	uint64_t sensing = std::chrono::minutes { 1 } / ACTIVE_SENSING_INTERVAL;
+
+	for (uint64_t k = 0; step_tick(k, sensing, rate) < duration; ++k)
+		emit(MidiEvent { step_tick(k, sensing, rate), midi2int(Midi::ACTIVE_SENSE), 0, 0, PORT_ALL });
+}
+
+// MIDI clock pulses in `[0, duration)`, `CLOCK_PPQ` to the quarter note.
+template <typename F>
+constexpr void realtime_clock(Tick duration, uint64_t bpm, Rate rate, F&& emit) {
+	for (uint64_t k = 0; step_tick(k, bpm * CLOCK_PPQ, rate) < duration; ++k)
+		emit(MidiEvent { step_tick(k, bpm * CLOCK_PPQ, rate), midi2int(Midi::TIMING_CLOCK), 0, 0, PORT_ALL });
+}
+
+// Reset state of MIDI devices and start.
+constexpr std::array<MidiEvent, BOOKEND_EVENTS - 1> bookend_front() {
+	std::array<MidiEvent, BOOKEND_EVENTS - 1> front {};
+
+	for (size_t i = 0; i != CHANNEL_MAX - CHANNEL_MIN; ++i) {
+		front[i * 3 + 0] = { 0, midi2int(Midi::CHANNEL_MODE), ALL_RESET_CC, 0, PORT_ALL };
+		front[i * 3 + 1] = { 0, midi2int(Midi::CHANNEL_MODE), ALL_NOTES_OFF, 0, PORT_ALL };
+		front[i * 3 + 2] = { 0, midi2int(Midi::CHANNEL_MODE), ALL_SOUND_OFF, 0, PORT_ALL };
+	}
+
+	front.back() = { 0, midi2int(Midi::START), 0, 0, PORT_ALL };
+
+	return front;
+}
+
+constexpr MidiEvent bookend_back(Tick duration) {
+	return { duration, midi2int(Midi::STOP), 0, 0, PORT_ALL };
+}
+
+// Budget
+// Every sequence is measured against `ctx.budget` before it is allocated
+// and every send before it is laid out, so an over-sized expression is
+// reported at its own span. Sizes are estimated in floating point so that
+// nothing can wrap on the way. Whatever is still held, chains, blocks and
+// operands waiting on the other side of an operator, is kept in `ctx.live`
+// and counted too.
+
+// Budgets are also checked by `static.hpp` so these are constexpr.
+constexpr uint64_t budget_count(double n) {
+	return n < static_cast<double>(std::numeric_limits<uint64_t>::max()) ?
+		static_cast<uint64_t>(n) : std::numeric_limits<uint64_t>::max();
+}
+
+// `std::ceil` for counts, which aren't negative.
+constexpr double budget_ceil(double n) {
+	if (not (n < static_cast<double>(std::numeric_limits<uint64_t>::max())))
+		return n;
+
+	double whole = static_cast<double>(static_cast<uint64_t>(n));
+	return whole < n ? whole + 1.0 : whole;
+}
+
+// Events `timeline_realtime` and `timeline_bookend` add to a timeline of
+// `minutes` of music which last `real` minutes following the tempo map.
+// Rounded up so that it is never short.
+constexpr double realtime_events(double minutes, double real, uint64_t bpm) {
+	double clock = minutes * bpm * CLOCK_PPQ;
+	double sensing = real * (std::chrono::minutes { 1 } / ACTIVE_SENSING_INTERVAL);
+
+	return budget_ceil(clock) + budget_ceil(sensing) + 2 + BOOKEND_EVENTS;
+}
+
+// Whether a timeline of `events` fits with `live` bytes held besides.
+constexpr bool budget_events_fit(const Budget& budget, double events, double live = 0.0) {
+	return events <= budget.events and live + events * sizeof(MidiEvent) <= budget.memory;
+}
+
+inline void budget_steps(Context& ctx, Lexer& lx, View sv, double steps) {
+	if (ctx.live + steps * sizeof(Event) > ctx.budget.memory)
+		lx.error(ctx, Phases::SEMANTIC, sv, STR_BUDGET_STEPS, budget_count(steps), ctx.live, ctx.budget.memory);
+}
+
+// Counts a sequence as held for as long as it's in scope.
+struct BudgetHold {
+	Context& ctx;
+	size_t bytes;
+
+	inline BudgetHold(Context& ctx_, const Sequence& seq):
+		ctx(ctx_), bytes(sequence_stored(seq) * sizeof(Event))
+	{
+		ctx.live += bytes;
+	}
+
+	inline ~BudgetHold() {
+		ctx.live -= bytes;
+	}
+
+	BudgetHold(const BudgetHold&) = delete;
+	BudgetHold& operator=(const BudgetHold&) = delete;
+};
+
+// `events` more ending at `end`, on top of everything sent so far and the
+// clock that will run for as long as the song does. Tempo changes aren't
+// built into a map until the end so the clock is estimated at the global
+// tempo.
+inline void budget_events(Context& ctx, Lexer& lx, View sv, double events, double end) {
+	double minutes = std::max(static_cast<double>(ctx.tl.duration), end) / ctx.rate;
+	double total = ctx.events + events + realtime_events(minutes, minutes, ctx.global_bpm);
+
+	if (not budget_events_fit(ctx.budget, total, ctx.live))
+		lx.error(ctx, Phases::SEMANTIC, sv, STR_BUDGET_EVENTS, budget_count(total), ctx.live, ctx.budget.events, ctx.budget.memory);
+}
+
+// Layers written out for operators that need every step.
+inline Sequence expand(Context& ctx, Lexer& lx, View sv, Sequence seq) {
+	if (not seq.layers.empty())
+		budget_steps(ctx, lx, sv, sequence_len(seq));
+
+	return sequence_expand(std::move(seq));
+}
+
 inline double literal(Context& ctx, Lexer& lx, View lit_v) {
 	CANE_LOG(LogLevel::INF);
 
@@ -187,6 +327,44 @@ inline double literal(Context& ctx, Lexer& lx, View lit_v) {
 	return b10_decode(view);
 }
 
+// Literals end up as counts, notes, channels and tempos. They are checked
+// while still floating point because converting a negative, infinite or NaN
+// value or one too large for the integer is undefined. `static.hpp` uses
+// the same checks.
+constexpr bool natural_fits(double lit) {
+	return lit >= 0.0 and lit < 18446744073709551616.0;  // 2^64
+}
+
+// A tempo of zero has no grid and divides by zero further on.
+constexpr bool bpm_fits(double lit) {
+	return lit >= BPM_MIN and lit <= BPM_MAX;
+}
+
+constexpr bool channel_fits(double lit) {
+	return lit >= CHANNEL_MIN and lit <= CHANNEL_MAX;
+}
+
+inline uint64_t literal_natural(Context& ctx, Lexer& lx, View sv, double lit) {
+	if (not natural_fits(lit))
+		lx.error(ctx, Phases::SEMANTIC, sv, STR_BETWEEN, 0, std::numeric_limits<uint64_t>::max());
+
+	return lit;
+}
+
+inline uint64_t literal_natural_expr(Context& ctx, Lexer& lx) {
+	View lit_v = lx.peek.view;
+	double lit = literal_expr(ctx, lx, lit_v, 0);
+
+	return literal_natural(ctx, lx, encompass(lit_v, lx.prev.view), lit);
+}
+
+inline uint64_t literal_bpm(Context& ctx, Lexer& lx, View sv, double lit) {
+	if (not bpm_fits(lit))
+		lx.error(ctx, Phases::SEMANTIC, sv, STR_BETWEEN, BPM_MIN, BPM_MAX);
+
+	return lit;
+}
+
 inline Sequence sequence(Context& ctx, Lexer& lx, View expr_v, Sequence seq) {
 	CANE_LOG(LogLevel::INF);
 
@@ -206,22 +384,25 @@ inline Sequence euclide(Context& ctx, Lexer& lx, View expr_v, Sequence seq) {
 
 	if (lx.peek.kind == Symbols::SEP) {
 		lx.next();  // skip `:`
-		beats = literal_expr(ctx, lx, lx.peek.view, 0);
+		beats = literal_natural_expr(ctx, lx);
 	}
 
-	else
-		beats = literal(ctx, lx, lx.peek.view);
+	else {
+		View beats_v = lx.peek.view;
+		beats = literal_natural(ctx, lx, beats_v, literal(ctx, lx, beats_v));
+	}
 
 	lx.expect(ctx, is(Symbols::SEP), lx.peek.view, STR_EXPECT, sym2str(Symbols::SEP));
 	lx.next();  // skip `:`
 
-	steps = literal_expr(ctx, lx, lx.peek.view, 0);
+	steps = literal_natural_expr(ctx, lx);
+	budget_steps(ctx, lx, encompass(expr_v, lx.prev.view), steps);
 
 	if (beats > steps)
 		lx.error(ctx, Phases::SEMANTIC, encompass(expr_v, lx.prev.view), STR_LESSER_EQ, steps);
 
 	for (size_t i = 0; i != static_cast<size_t>(steps); ++i)
-		seq.emplace_back(((i * beats) % steps) < static_cast<size_t>(beats));
+		seq.push_back(euclid_step(i, beats, steps));
 
 	if (seq.empty())
 		lx.error(ctx, Phases::SEMANTIC, encompass(expr_v, lx.prev.view), STR_EMPTY);
@@ -247,8 +428,10 @@ inline Sequence sequence_const(Context& ctx, Lexer& lx, View expr_v) {
 	lx.expect(ctx, is(Symbols::IDENT), lx.peek.view, STR_IDENT);
 	auto [view, kind] = lx.next();
 
-	if (auto it = ctx.chains.find(view); it != ctx.chains.end())
+	if (auto it = ctx.chains.find(view); it != ctx.chains.end()) {
+		budget_steps(ctx, lx, view, sequence_stored(it->second));
 		return it->second;
+	}
 
 	lx.error(ctx, Phases::SEMANTIC, view, STR_UNDEFINED, view);
 }
@@ -361,15 +544,23 @@ inline double literal_expr(Context& ctx, Lexer& lx, View lit_v, size_t bp) {
 	return lit;
 }
 
-inline uint8_t channel(Context& ctx, Lexer& lx) {
+inline Channel channel(Context& ctx, Lexer& lx) {
 	CANE_LOG(LogLevel::INF);
 
-	uint8_t chan = CHANNEL_MIN;
+	Channel chan { ctx.port, CHANNEL_MIN };
 	Token tok = lx.peek;
 
-	// Sink can be either a literal number or an alias defined previously.
-	if (is_literal(tok))
-		chan = literal(ctx, lx, lx.peek.view);
+	// Sink can be either a literal number on the current port or an alias
+	// defined previously which remembers its own port and was checked when
+	// it was.
+	if (is_literal(tok)) {
+		double lit = literal(ctx, lx, lx.peek.view);
+
+		if (not channel_fits(lit))
+			lx.error(ctx, Phases::SEMANTIC, tok.view, STR_BETWEEN, CHANNEL_MIN, CHANNEL_MAX);
+
+		chan.chan = lit;
+	}
 
 	else if (lx.peek.kind == Symbols::IDENT) {
 		lx.next();  // skip identifier
@@ -385,10 +576,8 @@ inline uint8_t channel(Context& ctx, Lexer& lx) {
 	else
 		lx.error(ctx, Phases::SYNTACTIC, tok.view, STR_IDENT_LITERAL);
 
-	if (chan > CHANNEL_MAX or chan < CHANNEL_MIN)
-		lx.error(ctx, Phases::SEMANTIC, tok.view, STR_BETWEEN, CHANNEL_MIN, CHANNEL_MAX);
-
-	return chan - 1;
+	chan.chan--;
+	return chan;
 }
 
 inline Sequence sequence_primary(Context& ctx, Lexer& lx, View expr_v, Sequence seq, size_t bp) {
@@ -432,10 +621,11 @@ inline Sequence sequence_prefix(Context& ctx, Lexer& lx, View expr_v, Sequence s
 
 	Token tok = lx.next();
 	CANE_LOG(LogLevel::INF, sym2str(tok.kind));
+	CANE_TRACE_SPAN(sym2str(tok.kind));
 
 	switch (tok.kind) {
-		case Symbols::REV:    { seq = sequence_reverse (sequence_expr(ctx, lx, expr_v, bp)); } break;
-		case Symbols::INVERT: { seq = sequence_invert  (sequence_expr(ctx, lx, expr_v, bp)); } break;
+		case Symbols::REV:    { seq = sequence_reverse (expand(ctx, lx, tok.view, sequence_expr(ctx, lx, expr_v, bp))); } break;
+		case Symbols::INVERT: { seq = sequence_invert  (expand(ctx, lx, tok.view, sequence_expr(ctx, lx, expr_v, bp))); } break;
 
 		default: { lx.error(ctx, Phases::SYNTACTIC, tok.view, STR_SEQ_OPERATOR); } break;
 	}
@@ -448,19 +638,60 @@ inline Sequence sequence_infix(Context& ctx, Lexer& lx, View expr_v, Sequence se
 
 	Token tok = lx.next();  // skip operator.
 	CANE_LOG(LogLevel::INF, sym2str(tok.kind));
+	CANE_TRACE_SPAN(sym2str(tok.kind));
+
+	// Layers are only kept through operators which don't look at steps.
+	if (not cmp_any(tok.kind, Symbols::POLY_OR, Symbols::POLY_AND, Symbols::POLY_XOR, Symbols::BPM, Symbols::CHAIN))
+		seq = expand(ctx, lx, encompass(expr_v, tok.view), std::move(seq));
+
+	// The left side is held while the right is compiled.
+	auto operand = [&] {
+		BudgetHold hold { ctx, seq };
+		return sequence_expr(ctx, lx, expr_v, bp);
+	};
 
 	switch (tok.kind) {
-		case Symbols::CAT: { seq = sequence_cat (std::move(seq), sequence_expr(ctx, lx, expr_v, bp)); } break;
-		case Symbols::OR:  { seq = sequence_or  (std::move(seq), sequence_expr(ctx, lx, expr_v, bp)); } break;
-		case Symbols::AND: { seq = sequence_and (std::move(seq), sequence_expr(ctx, lx, expr_v, bp)); } break;
-		case Symbols::XOR: { seq = sequence_xor (std::move(seq), sequence_expr(ctx, lx, expr_v, bp)); } break;
+		case Symbols::OR:  { seq = sequence_or  (std::move(seq), expand(ctx, lx, tok.view, operand())); } break;
+		case Symbols::AND: { seq = sequence_and (std::move(seq), expand(ctx, lx, tok.view, operand())); } break;
+		case Symbols::XOR: { seq = sequence_xor (std::move(seq), expand(ctx, lx, tok.view, operand())); } break;
+
+		case Symbols::CAT: {
+			Sequence rhs = expand(ctx, lx, tok.view, operand());
 
-		case Symbols::ROTL: { seq = sequence_rotl (std::move(seq), literal_expr(ctx, lx, tok.view, 0)); } break;
-		case Symbols::ROTR: { seq = sequence_rotr (std::move(seq), literal_expr(ctx, lx, tok.view, 0)); } break;
+			{
+				// Both sides are still around while the result is allocated.
+				BudgetHold lhs_hold { ctx, seq };
+				BudgetHold rhs_hold { ctx, rhs };
+
+				budget_steps(ctx, lx, encompass(expr_v, lx.prev.view), seq.size() + rhs.size());
+			}
+
+			seq = sequence_cat(std::move(seq), std::move(rhs));
+		} break;
+
+		case Symbols::POLY_OR:
+		case Symbols::POLY_AND:
+		case Symbols::POLY_XOR: {
+			View before_v = lx.peek.view;
+			Sequence rhs = operand();
+
+			if (not poly_len(sequence_len(seq), sequence_len(rhs)))
+				lx.error(ctx, Phases::SEMANTIC, encompass(before_v, lx.prev.view), STR_POLY_LENGTH);
+
+			seq = sequence_poly(std::move(seq), std::move(rhs), tok.kind);
+		} break;
+
+		case Symbols::ROTL: { seq = sequence_rotl (std::move(seq), literal_natural_expr(ctx, lx)); } break;
+		case Symbols::ROTR: { seq = sequence_rotr (std::move(seq), literal_natural_expr(ctx, lx)); } break;
 
 		case Symbols::REP: {
 			View before_v = lx.peek.view;
-			uint64_t reps = literal_expr(ctx, lx, before_v, 0);
+			uint64_t reps = literal_natural_expr(ctx, lx);
+
+			{
+				BudgetHold hold { ctx, seq };
+				budget_steps(ctx, lx, encompass(before_v, lx.prev.view), seq.size() * static_cast<double>(reps));
+			}
 
 			// We don't want to shrink the sequence, it can only grow.
 			if (reps == 0)
@@ -471,24 +702,25 @@ inline Sequence sequence_infix(Context& ctx, Lexer& lx, View expr_v, Sequence se
 
 		case Symbols::BPM: {
 			View before_v = lx.peek.view;
-			uint64_t bpm = literal_expr(ctx, lx, before_v, 0);
-			seq.bpm = bpm;
+			double bpm = literal_expr(ctx, lx, before_v, 0);
+			seq.bpm = literal_bpm(ctx, lx, encompass(before_v, lx.prev.view), bpm);
 		} break;
 
 		case Symbols::MAP: {
 			lx.expect(ctx, is_literal_primary, lx.peek.view, STR_LIT_EXPR);
 
 			std::vector<uint64_t> notes;
-			while (is_literal_primary(lx.peek)) {
-				uint64_t note = literal_expr(ctx, lx, lx.peek.view, 0);
-				notes.emplace_back(note);
-			}
+			while (is_literal_primary(lx.peek))
+				notes.emplace_back(literal_natural_expr(ctx, lx));
 
-			size_t index = 0;
-			for (auto& [note, kind]: seq) {
-				note = notes[index];
-				index = (index + 1) % notes.size();
-			}
+			parallel_for(seq.size(), [&] (size_t begin, size_t end) {
+				size_t index = begin % notes.size();
+
+				for (size_t i = begin; i != end; ++i) {
+					seq[i].note = notes[index];
+					index = (index + 1) % notes.size();
+				}
+			});
 		} break;
 
 		case Symbols::CHAIN: {
@@ -499,8 +731,18 @@ inline Sequence sequence_infix(Context& ctx, Lexer& lx, View expr_v, Sequence se
 			if (auto [it, succ] = ctx.symbols.emplace(view); not succ)
 				lx.error(ctx, Phases::SEMANTIC, view, STR_CONFLICT, view);
 
+			// The copy stays for the rest of the song.
+			size_t stored = sequence_stored(seq);
+
+			{
+				BudgetHold hold { ctx, seq };
+				budget_steps(ctx, lx, view, stored);
+			}
+
 			if (auto [it, succ] = ctx.chains.try_emplace(view, seq); not succ)
 	    		lx.error(ctx, Phases::SEMANTIC, view, STR_REDEFINED, view);
+
+			ctx.live += stored * sizeof(Event);
 		} break;
 
 		default: { lx.error(ctx, Phases::SYNTACTIC, tok.view, STR_SEQ_OPERATOR); } break;
@@ -514,16 +756,18 @@ inline Sequence sequence_postfix(Context& ctx, Lexer& lx, View expr_v, Sequence
 
 	Token tok = lx.next();  // skip operator.
 	CANE_LOG(LogLevel::INF, sym2str(tok.kind));
+	CANE_TRACE_SPAN(sym2str(tok.kind));
 
 	switch (tok.kind) {
-		case Symbols::CAR: { seq = sequence_car(std::move(seq)); } break;
-		case Symbols::CDR: { seq = sequence_cdr(std::move(seq)); } break;
+		case Symbols::CAR: { seq = sequence_car(expand(ctx, lx, encompass(expr_v, tok.view), std::move(seq))); } break;
+		case Symbols::CDR: { seq = sequence_cdr(expand(ctx, lx, encompass(expr_v, tok.view), std::move(seq))); } break;
 
 		case Symbols::DBG: {
-			auto mini = sequence_minify(seq);
-			size_t count = seq.size() / mini.size();
+			auto full = expand(ctx, lx, encompass(expr_v, tok.view), seq);
+			auto mini = sequence_minify(full);
+			size_t count = full.size() / mini.size();
 
-			lx.notice(ctx, Phases::SEMANTIC, encompass(expr_v, tok.view), STR_DEBUG, mini, count, seq.size());
+			lx.notice(ctx, Phases::SEMANTIC, encompass(expr_v, tok.view), STR_DEBUG, mini, count, full.size());
 		} break;
 
 		default: { lx.error(ctx, Phases::SYNTACTIC, tok.view, STR_SEQ_OPERATOR); } break;
@@ -551,6 +795,7 @@ inline Sequence sequence_expr(Context& ctx, Lexer& lx, View expr_v, size_t bp) {
 	else
 		lx.error(ctx, Phases::SYNTACTIC, tok.view, STR_SEQ_PRIMARY);
 
+	ctx.stats.steps += seq.size();
 	tok = lx.peek;
 
 	while (
@@ -578,52 +823,170 @@ inline Sequence sequence_expr(Context& ctx, Lexer& lx, View expr_v, size_t bp) {
 		else
 			lx.error(ctx, Phases::SYNTACTIC, tok.view, STR_SEQ_OPERATOR);
 
+		ctx.stats.steps += seq.size();
 		tok = lx.peek;
 	}
 
 	return seq;
 }
 
-inline Timeline sequence_compile(Sequence seq, uint8_t chan, Unit time) {
+// Note on and off of a beat at step `k` of a sequence sent at `time`. Every
+// step is placed relative to the start rather than the previous step so
+// rounding on an inexact grid can't accumulate.
+constexpr std::array<MidiEvent, 2> beat_events(Tick time, uint64_t k, uint64_t bpm, Rate rate, Channel chan, uint8_t note) {
+	return {
+		MidiEvent { time + step_tick(k, bpm, rate), static_cast<uint8_t>(midi2int(Midi::NOTE_ON) | chan.chan), note, VELOCITY_DEFAULT, chan.port },
+		MidiEvent { time + step_tick(k + 1, bpm, rate), static_cast<uint8_t>(midi2int(Midi::NOTE_OFF) | chan.chan), note, VELOCITY_DEFAULT, chan.port },
+	};
+}
+
+// Layers are combined a step at a time as they're laid out so that a
+// polymeter is never expanded into a sequence first.
+inline Timeline sequence_compile(Sequence seq, uint8_t chan, Tick time, Rate rate, uint8_t port = PORT_DEFAULT) {
 	CANE_LOG(LogLevel::INF);
 
 	Timeline tl {};
+	tl.rate = rate;
+
+	size_t n = sequence_len(seq);
+
+	// Beats are counted per chunk first so that each chunk knows where in
+	// the timeline its events start and can write them independently.
+	std::vector<size_t> offsets((n + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK + 1, 0u);
+
+	parallel_for(n, [&] (size_t begin, size_t end) {
+		size_t beats = 0;
+
+		for (size_t k = begin; k != end; ++k)
+			beats += sequence_step(seq, k).kind == BEAT;
+
+		offsets[begin / PARALLEL_CHUNK + 1] = beats * 2;
+	});
+
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+	tl.resize(offsets.back());
+
+	parallel_for(n, [&] (size_t begin, size_t end) {
+		MidiEvent* out = tl.data() + offsets[begin / PARALLEL_CHUNK];
 
-	auto per = ONE_MIN / seq.bpm;
+		for (size_t k = begin; k != end; ++k) {
+			auto [note, kind] = sequence_step(seq, k);
 
-	auto ON = midi2int(Midi::NOTE_ON) | chan;
-	auto OFF = midi2int(Midi::NOTE_OFF) | chan;
+			if (kind == BEAT) {
+				auto [on, off] = beat_events(time, k, seq.bpm, rate, Channel { port, chan }, note);
 
-	for (auto& [note, kind]: seq) {
-		if (kind == BEAT) {
-			tl.emplace_back(time, ON, note, VELOCITY_DEFAULT);
-			tl.emplace_back(time + per, OFF, note, VELOCITY_DEFAULT);
+				*out++ = on;
+				*out++ = off;
+			}
 		}
+	});
+
+	tl.duration = time + step_tick(n, seq.bpm, rate);
+
+	return tl;
+}
+
+// Refine the grid so that steps at `bpm` land on it exactly, scaling
+// everything compiled so far to match.
+inline void timeline_refine(Context& ctx, Lexer& lx, View sv, uint64_t bpm) {
+	Rate rate = rate_refine(ctx.rate, bpm);
+
+	if (rate == 0) {
+		if (not ctx.inexact)
+			lx.warning(ctx, Phases::SEMANTIC, sv, STR_RATE_INEXACT, bpm);
 
-		time += per;
+		ctx.inexact = true;
+		return;
 	}
 
-	tl.duration = time;
+	if (rate == ctx.rate)
+		return;
 
-	return tl;
+	Tick factor = rate / ctx.rate;
+
+	for (Block& block: ctx.blocks) {
+		for (MidiEvent& ev: block.events)
+			ev.time *= factor;
+
+		block.period *= factor;
+	}
+
+	for (Origin& origin: ctx.tl.origins) {
+		origin.begin *= factor;
+		origin.end *= factor;
+	}
+
+	for (TempoMark& mark: ctx.tempo)
+		mark.time *= factor;
+
+	ctx.tl.duration *= factor;
+	ctx.time *= factor;
+	ctx.rate = rate;
 }
 
-inline Timeline send(Context& ctx, Lexer& lx, View stat_v, Unit time) {
+// Returns where the send ends.
+inline Tick send(Context& ctx, Lexer& lx, View stat_v, Tick& time) {
 	CANE_LOG(LogLevel::INF);
+	CANE_TRACE_SPAN("send"_sv);
 
 	lx.expect(ctx, is(Symbols::SEND), lx.peek.view, STR_EXPECT, sym2str(Symbols::SEND));
 	lx.next();  // skip `send`
 
-	uint8_t chan = channel(ctx, lx);
+	Channel chan = channel(ctx, lx);
 	Sequence seq = sequence_expr(ctx, lx, lx.peek.view, 0);
 
-	Timeline tl = sequence_compile(std::move(seq), chan, time);
+	View send_v = encompass(stat_v, lx.prev.view);
 
-	return tl;
+	// Layers aren't expanded to be laid out but it still takes a pass over
+	// every step.
+	size_t steps = sequence_len(seq);
+	budget_steps(ctx, lx, send_v, steps);
+
+	// Looping the shortest block that repeats plays back the same, only
+	// that is kept.
+	if (ctx.loops != nullptr)
+		ctx.loops->push_back({ sequence_minify(sequence_expand(seq), step_identical), chan });
+
+	// `time` is rescaled along with everything else if the grid changes.
+	Rate before = ctx.rate;
+	timeline_refine(ctx, lx, send_v, seq.bpm);
+	time *= ctx.rate / before;
+
+	double end = time + static_cast<double>(steps) / seq.bpm * ctx.rate;
+	size_t events = 2 * sequence_beats(seq);
+
+	budget_events(ctx, lx, send_v, events, end);
+
+	// On an exact grid every repeat of the shortest block that repeats
+	// starts the same number of ticks after the last, so only that block
+	// is compiled. Layers are left whole rather than expanded to look.
+	uint64_t count = 1;
+
+	if (ctx.rate % seq.bpm == 0 and seq.layers.empty()) {
+		size_t period = sequence_period(seq, step_identical);
+
+		count = steps / period;
+		seq.resize(period);
+	}
+
+	StatTimer timer { ctx.stats, ctx.stats.compiling };
+	Timeline tl = sequence_compile(std::move(seq), chan.chan, time, ctx.rate, chan.port);
+
+	Tick period = tl.duration - time;
+	Tick last = time + period * static_cast<Tick>(count);
+
+	ctx.live += tl.size() * sizeof(MidiEvent);
+	ctx.blocks.push_back({ std::move(static_cast<std::vector<MidiEvent>&>(tl)), period, count });
+	ctx.events += events;
+
+	ctx.tl.origins.push_back({ send_v, time, last });
+
+	return last;
 }
 
 inline void statement(Context& ctx, Lexer& lx, View stat_v) {
 	CANE_LOG(LogLevel::WRN);
+	CANE_TRACE_SPAN("statement"_sv);
 
 	Token tok = lx.peek;
 
@@ -634,19 +997,49 @@ inline void statement(Context& ctx, Lexer& lx, View stat_v) {
 		lx.expect(ctx, is(Symbols::IDENT), lx.peek.view, STR_IDENT);
 		auto [view, kind] = lx.next();  // get identifier
 
-		uint8_t chan = literal(ctx, lx, lx.peek.view);
+		double lit = literal(ctx, lx, lx.peek.view);
 
-		if (chan > CHANNEL_MAX or chan < CHANNEL_MIN)
+		if (not channel_fits(lit))
 			lx.error(ctx, Phases::SEMANTIC, lx.prev.view, STR_BETWEEN, CHANNEL_MIN, CHANNEL_MAX);
 
+		uint8_t chan = lit;
+
 		// Assign or warn if re-assigned.
 		if (auto [it, succ] = ctx.symbols.emplace(view); not succ)
 			lx.error(ctx, Phases::SEMANTIC, view, STR_CONFLICT, view);
 
-		if (auto [it, succ] = ctx.channels.try_emplace(view, chan); not succ)
+		if (auto [it, succ] = ctx.channels.try_emplace(view, Channel { ctx.port, chan }); not succ)
 			lx.error(ctx, Phases::SEMANTIC, view, STR_REDEFINED, view);
 	}
 
+	// Switch to another output port, declaring it the first time. Ports
+	// have their own names so they don't conflict with other symbols.
+	else if (tok.kind == Symbols::PORT) {
+		CANE_LOG(LogLevel::INF, sym2str(Symbols::PORT));
+		lx.next();  // skip `port`
+
+		lx.expect(ctx, is(Symbols::IDENT), lx.peek.view, STR_IDENT);
+		auto [view, kind] = lx.next();  // get identifier
+
+		auto& ports = ctx.tl.ports;
+
+		auto it = std::find_if(ports.begin(), ports.end(), [&] (const PortName& name) {
+			return view == View { name.data() };
+		});
+
+		if (it == ports.end()) {
+			if (ports.size() == PORT_MAX)
+				lx.error(ctx, Phases::SEMANTIC, view, STR_PORT_MAX, PORT_MAX);
+
+			if (view.size() >= PORT_NAME_MAX)
+				lx.error(ctx, Phases::SEMANTIC, view, STR_PORT_NAME, PORT_NAME_MAX - 1);
+
+			it = ports.insert(ports.end(), port_name(view));
+		}
+
+		ctx.port = it - ports.begin();
+	}
+
 	else if (tok.kind == Symbols::LET) {
 		CANE_LOG(LogLevel::INF, sym2str(Symbols::LET));
 		lx.next();  // skip `let`
@@ -664,28 +1057,42 @@ inline void statement(Context& ctx, Lexer& lx, View stat_v) {
 			lx.error(ctx, Phases::SEMANTIC, view, STR_REDEFINED, view);
 	}
 
+	// Tempo changes take effect where the last send finished. `=>` ramps
+	// to the new tempo from the previous change instead of jumping.
+	else if (tok.kind == Symbols::TEMPO) {
+		CANE_LOG(LogLevel::INF, sym2str(Symbols::TEMPO));
+		lx.next();  // skip `tempo`
+
+		bool ramp = lx.peek.kind == Symbols::CHAIN;
+
+		if (ramp)
+			lx.next();  // skip `=>`
+
+		View bpm_v = lx.peek.view;
+		double bpm = literal_expr(ctx, lx, bpm_v, 0);
+
+		literal_bpm(ctx, lx, encompass(bpm_v, lx.prev.view), bpm);
+		ctx.tempo.push_back({ ctx.time, bpm, ramp });
+	}
+
 	else if (is_sequence_primary(tok) or is_sequence_prefix(tok)) {
 		Sequence seq = sequence_expr(ctx, lx, lx.peek.view, 0);
 	}
 
 	else if (tok.kind == Symbols::SEND) {
-		Unit orig = ctx.time;
-		Timeline tl = send(ctx, lx, lx.peek.view, ctx.time);
+		Tick orig = ctx.time;
+		Tick end = send(ctx, lx, lx.peek.view, orig);
 
-		ctx.time = std::max(tl.duration, ctx.time);
-		ctx.tl.duration = std::max(tl.duration, ctx.tl.duration);
-
-		ctx.tl.insert(ctx.tl.end(), tl.begin(), tl.end());
+		ctx.time = std::max(end, ctx.time);
+		ctx.tl.duration = std::max(end, ctx.tl.duration);
 
 		while (lx.peek.kind == Symbols::WITH) {
 			lx.next();  // skip `$`
 
-			Timeline tl = send(ctx, lx, lx.peek.view, orig);
-
-			ctx.time = std::max(tl.duration, ctx.time);
-			ctx.tl.duration = std::max(tl.duration, ctx.tl.duration);
+			Tick end = send(ctx, lx, lx.peek.view, orig);
 
-			ctx.tl.insert(ctx.tl.end(), tl.begin(), tl.end());
+			ctx.time = std::max(end, ctx.time);
+			ctx.tl.duration = std::max(end, ctx.tl.duration);
 		}
 	}
 
@@ -693,17 +1100,122 @@ inline void statement(Context& ctx, Lexer& lx, View stat_v) {
 		lx.error(ctx, Phases::SYNTACTIC, tok.view, STR_STATEMENT);
 }
 
+// Lay out every repeat of every block in the order they were sent, each
+// repeat shifted along by the block's period. Each block is freed once it
+// is laid out rather than all of them at the end.
+inline Timeline timeline_flatten(Timeline tl, std::vector<Block> blocks) {
+	CANE_LOG(LogLevel::INF);
+	CANE_TRACE_SPAN("flatten"_sv);
+
+	for (Block& block: blocks) {
+		for (uint64_t i = 0; i != block.count; ++i) {
+			Tick offset = block.period * static_cast<Tick>(i);
+
+			for (MidiEvent ev: block.events) {
+				ev.time += offset;
+				tl.push_back(ev);
+			}
+		}
+
+		std::vector<MidiEvent>().swap(block.events);
+	}
+
+	return tl;
+}
+
+inline Timeline timeline_realtime(Timeline tl, uint64_t bpm) {
+	CANE_LOG(LogLevel::INF);
+	CANE_TRACE_SPAN("realtime"_sv);
+
+	auto emit = [&] (const MidiEvent& ev) {
+		tl.push_back(ev);
+	};
+
+	// Active sensing
+	// Sensing is in real time so it is placed through the tempo map.
+	if (tl.tempo.empty())
+		realtime_sensing(tl.duration, tl.rate, emit);
+
+	else {
+		TempoView tempo { tl.tempo };
+
+		for (uint64_t k = 0;; ++k) {
+			Tick t = tempo_tick(tempo, k * ACTIVE_SENSING_INTERVAL, tl.rate);
+
+			if (t >= tl.duration)
+				break;
+
+			tl.emplace_back(t, midi2int(Midi::ACTIVE_SENSE), 0, 0, PORT_ALL);
+		}
+	}
+
+	// MIDI clock pulse
+	// We fire off a MIDI tick 24 times
+	// for every quarter note. Pulses are in musical time so
+	// the clock follows the tempo map.
+	realtime_clock(tl.duration, bpm, tl.rate, emit);
+
+	return tl;
+}
+
+inline Timeline timeline_sort(Timeline tl) {
+	CANE_LOG(LogLevel::INF);
+	CANE_TRACE_SPAN("sort"_sv);
+
+	// Sort sequence by timestamps
+	std::stable_sort(tl.begin(), tl.end(), [] (auto& a, auto& b) {
+		return a.time < b.time;
+	});
+
+	return tl;
+}
+
+inline Timeline timeline_bookend(Timeline tl) {
+	CANE_LOG(LogLevel::INF);
+	CANE_TRACE_SPAN("bookend"_sv);
+
+	// All inserted in one go so the timeline is only shifted along once.
+	auto front = bookend_front();
+
+	tl.insert(tl.begin(), front.begin(), front.end());
+	tl.push_back(bookend_back(tl.duration));
+
+	return tl;
+}
+
 inline Timeline compile(
 	View src,
-	Handler&& error_handler,
-	Handler&& warning_handler,
-	Handler&& notice_handler
+	Reporter reporter,
+	Stats* stats = nullptr,
+	std::vector<Loop>* loops = nullptr,
+	const std::atomic<bool>* cancel = nullptr,
+	Budget budget = {}
 ) {
 	CANE_LOG(LogLevel::WRN);
+	CANE_TRACE_SPAN("compile"_sv);
+
+	// Checked between statements so that whoever asked for the timeline
+	// can give up on it early. Nothing is reported, they know why.
+	auto check_cancel = [&] {
+		if (cancel != nullptr and cancel->load(std::memory_order_relaxed))
+			throw Error {};
+	};
 
-	Context ctx { std::move(error_handler), std::move(warning_handler), std::move(notice_handler) };
+	Context ctx { reporter };
 	Lexer lx { src, ctx };
 
+	ctx.stats.enabled = stats != nullptr;
+	ctx.budget = budget;
+	ctx.loops = loops;
+
+	// The default port always exists, others are declared with `port`.
+	ctx.tl.ports.push_back(port_name(CSTR_PORT));
+	std::optional<StatTimer> total { std::in_place, ctx.stats, ctx.stats.total };
+
+	// Only the front-end is timed here, lexing and compiling are timed
+	// separately and subtracted once we're done.
+	std::optional<StatTimer> front { std::in_place, ctx.stats, ctx.stats.parsing };
+
 	lx.next(); // important
 
 	if (not cane::validate(src))
@@ -724,15 +1236,17 @@ inline Timeline compile(
 		switch (kind) {
 			case Symbols::GLOBAL_BPM: {
 				CANE_LOG(LogLevel::INF, sym2str(Symbols::GLOBAL_BPM));
-				uint64_t bpm = literal_expr(ctx, lx, lx.peek.view, 0);
-				ctx.global_bpm = bpm;
+
+				View bpm_v = lx.peek.view;
+				double bpm = literal_expr(ctx, lx, bpm_v, 0);
+
+				ctx.global_bpm = literal_bpm(ctx, lx, encompass(bpm_v, lx.prev.view), bpm);
 				flags |= META_BPM;
 			} break;
 
 			case Symbols::GLOBAL_NOTE: {
 				CANE_LOG(LogLevel::INF, sym2str(Symbols::GLOBAL_NOTE));
-				uint64_t note = literal_expr(ctx, lx, lx.peek.view, 0);
-				ctx.global_note = note;
+				ctx.global_note = literal_natural_expr(ctx, lx);
 				flags |= META_NOTE;
 			} break;
 
@@ -746,50 +1260,81 @@ inline Timeline compile(
 	if ((flags & META_NOTE) != META_NOTE)
 		lx.error(ctx, Phases::SEMANTIC, lx.peek.view, STR_NO_NOTE);
 
-	while (lx.peek.kind != Symbols::TERMINATOR)
+	ctx.rate = timeline_rate(ctx.global_bpm);
+
+	while (lx.peek.kind != Symbols::TERMINATOR) {
+		check_cancel();
 		statement(ctx, lx, lx.peek.view);
+	}
+
+	check_cancel();
+
+	front.reset();
+	ctx.stats.parsing -= ctx.stats.lexing + ctx.stats.compiling;
 
 	Timeline tl = std::move(ctx.tl);
+	tl.bpm = ctx.global_bpm;
+	tl.rate = ctx.rate;
+	tl.tempo = tempo_map(ctx.tempo, ctx.global_bpm, ctx.rate);
 
-	if (tl.empty())
-		return tl;
+	if (ctx.events != 0) {
+		// Room for every repeat and everything still to be added so that
+		// it's allocated once.
+		double minutes = static_cast<double>(tl.duration) / tl.rate;
+		double real = timeline_seconds(tl, tl.duration).count() / 60.0;
 
-	// Active sensing
-	Unit t = Unit::zero();
-	while (t < tl.duration) {
-		tl.emplace_back(t, midi2int(Midi::ACTIVE_SENSE), 0, 0);
-		t += ACTIVE_SENSING_INTERVAL;
-	}
+		tl.reserve(ctx.events + budget_count(realtime_events(minutes, real, ctx.global_bpm)));
 
-	// MIDI clock pulse
-	// We fire off a MIDI tick 24 times
-	// for every quarter note
-	Unit clock_freq = std::chrono::duration_cast<cane::Unit>(std::chrono::minutes { 1 }) / (ctx.global_bpm * 24);
-	t = Unit::zero();
-	while (t < tl.duration) {
-		tl.emplace_back(t, midi2int(Midi::TIMING_CLOCK), 0, 0);
-		t += clock_freq;
-	}
+		{
+			StatTimer timer { ctx.stats, ctx.stats.compiling };
+			tl = timeline_flatten(std::move(tl), std::move(ctx.blocks));
+		}
 
-	// Sort sequence by timestamps
-	std::stable_sort(tl.begin(), tl.end(), [] (auto& a, auto& b) {
-		return a.time < b.time;
-	});
+		{
+			StatTimer timer { ctx.stats, ctx.stats.realtime };
+			tl = timeline_realtime(std::move(tl), ctx.global_bpm);
+		}
 
-	// Start/Stop
-	tl.emplace(tl.begin(), Unit::zero(), midi2int(Midi::START), 0, 0);
-	tl.emplace(tl.end(), tl.duration, midi2int(Midi::STOP), 0, 0);
+		{
+			StatTimer timer { ctx.stats, ctx.stats.sorting };
+			tl = timeline_sort(std::move(tl));
+		}
 
-	// Reset state of MIDI devices
-	for (size_t i = CHANNEL_MIN; i != CHANNEL_MAX; ++i) {
-		tl.emplace(tl.begin(), Unit::zero(), midi2int(Midi::CHANNEL_MODE), ALL_SOUND_OFF, 0);
-		tl.emplace(tl.begin(), Unit::zero(), midi2int(Midi::CHANNEL_MODE), ALL_NOTES_OFF, 0);
-		tl.emplace(tl.begin(), Unit::zero(), midi2int(Midi::CHANNEL_MODE), ALL_RESET_CC, 0);
+		{
+			StatTimer timer { ctx.stats, ctx.stats.bookend };
+			tl = timeline_bookend(std::move(tl));
+		}
 	}
 
+	total.reset();
+	ctx.stats.events = tl.size();
+
+	if (stats != nullptr)
+		*stats = ctx.stats;
+
 	return tl;
 }
 
+// One handler per kind of report.
+inline Timeline compile(
+	View src,
+	Handler&& error_handler,
+	Handler&& warning_handler,
+	Handler&& notice_handler,
+	Stats* stats = nullptr,
+	std::vector<Loop>* loops = nullptr,
+	const std::atomic<bool>* cancel = nullptr,
+	Budget budget = {}
+) {
+	std::array<Handler, 3> handlers { error_handler, warning_handler, notice_handler };
+
+	Reporter reporter { [] (void* user, Reports kind, Phases phase, View original, View sv, std::string str) {
+		static_cast<Handler*>(user)[static_cast<int>(kind)](phase, original, sv, std::move(str));
+	}, handlers.data() };
+
+	return compile(src, reporter, stats, loops, cancel, budget);
+}
+
 }
 
 #endif
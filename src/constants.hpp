@@ -5,14 +5,24 @@ namespace cane {
 
 constexpr size_t CHANNEL_MIN      = 1u;
 constexpr size_t CHANNEL_MAX      = 16u;
+constexpr size_t PORT_MAX         = 8u;   // Output ports, each with its own channels.
+constexpr size_t PORT_NAME_MAX    = 64u;  // Including the terminator.
 constexpr size_t BPM_MIN          = 1u;
+constexpr size_t BPM_MAX          = 1u << 20;  // Keeps the grid of any tempo under `RATE_MAX`.
 constexpr size_t BPM_DEFAULT      = 120u;
 
 constexpr size_t CHANNEL_DEFAULT  = 1u;
 constexpr size_t NOTE_DEFAULT     = 60u; // Middle C
 constexpr size_t VELOCITY_DEFAULT = 127u;
 
+constexpr uint8_t PORT_DEFAULT = 0u;
+constexpr uint8_t PORT_ALL     = 0xFFu;  // System messages go out on every port.
+
 constexpr auto ACTIVE_SENSING_INTERVAL = std::chrono::milliseconds { 250 };
+constexpr size_t CLOCK_PPQ = 24u;  // MIDI clock pulses per quarter note.
+
+constexpr size_t BUDGET_MEMORY = 1ull << 30;  // Bytes, see `Budget`.
+constexpr size_t BUDGET_EVENTS = 1ull << 26;
 
 constexpr auto ALL_SOUND_OFF = 120;
 constexpr auto ALL_RESET_CC  = 121;
@@ -99,6 +109,21 @@ constexpr auto LOCAL_CONTROL_OFF = 0;
 		}
 	#undef X
 
+	// Bytes a message takes on the wire. System realtime messages are a
+	// lone status byte, program change and channel pressure take one data
+	// byte and everything else we send takes two.
+	constexpr uint8_t midi_length(uint8_t status) {
+		if (status >= 0xF8)
+			return 1u;
+
+		uint8_t kind = status & 0xF0;
+
+		if (kind == 0xC0 or kind == 0xD0)
+			return 2u;
+
+		return 3u;
+	}
+
 #undef MIDI
 
 
@@ -123,6 +148,8 @@ constexpr auto LOCAL_CONTROL_OFF = 0;
 	\
 	X(ALIAS, "alias") \
 	X(LET,   "let") \
+	X(TEMPO, "tempo") \
+	X(PORT,  "port") \
 	\
 	/* Sequence */ \
 	X(SEP,  ":") \
@@ -151,6 +178,10 @@ constexpr auto LOCAL_CONTROL_OFF = 0;
 	X(OR,  "|") \
 	X(AND, "&") \
 	X(XOR, "^") \
+	\
+	X(POLY_OR,  "||") \
+	X(POLY_AND, "&&") \
+	X(POLY_XOR, "^^") \
 	X(CAT, ",") \
 	\
 	X(INVERT, "~") \
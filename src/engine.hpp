@@ -0,0 +1,165 @@
+#ifndef CANE_ENGINE_HPP
+#define CANE_ENGINE_HPP
+
+namespace cane {
+
+// Embedding.
+// An engine compiles sources in-process and hands back everything that
+// happened as a result instead of throwing or printing. Engines share no
+// state so a host can keep one per thread and compile on all of them at
+// once. Recent results are kept along with their source so that
+// recompiling an unchanged source is only a lookup.
+
+constexpr size_t ENGINE_CACHE_MAX = 8u;  // Results kept per engine.
+
+struct Diagnostic {
+	Reports kind = Reports::ERROR;
+	Phases phase = Phases::INTERNAL;
+
+	Location location {};
+	size_t offset = 0;  // Span in bytes from the start of the source.
+	size_t length = 0;
+
+	std::string message;
+};
+
+struct Result {
+	std::shared_ptr<const Timeline> timeline;  // Null if compilation failed.
+	std::vector<Diagnostic> diagnostics;
+	Stats stats;
+
+	inline bool ok() const {
+		return timeline != nullptr;
+	}
+};
+
+// A result along with everything that went into it.
+struct CacheEntry {
+	uint64_t hash = 0;  // Of `src`, compared first.
+	std::string src;
+
+	bool stats = false;
+	Budget budget {};
+
+	Result result;
+};
+
+struct Engine {
+	using Listener = void(*)(void*, const Diagnostic&);
+
+	// Told about every diagnostic as it happens, i.e. to print it.
+	Listener listener = nullptr;
+	void* user = nullptr;
+
+	bool stats = false;  // Time every phase.
+	Budget budget {};
+	size_t cache_max = ENGINE_CACHE_MAX;
+
+	std::vector<CacheEntry> cache;  // Most recent last.
+
+	inline void notify(const Diagnostic& d) const {
+		if (listener != nullptr)
+			listener(user, d);
+	}
+
+	// Nothing thrown while compiling escapes, it is reported instead. A
+	// result which failed to compile has at least one diagnostic unless it
+	// was cancelled.
+	inline Result compile(View src, const std::atomic<bool>* cancel = nullptr) {
+		CANE_LOG(LogLevel::WRN);
+
+		std::string_view source { src.begin, src.size() };
+		uint64_t hash = hash_source(source);
+
+		// A hash can collide so the source itself has to match as well as
+		// the settings it was compiled with.
+		auto hit = [&] (const CacheEntry& e) {
+			return
+				e.hash == hash and
+				e.stats == stats and
+				e.budget.memory == budget.memory and
+				e.budget.events == budget.events and
+				e.src == source;
+		};
+
+		// Diagnostics are replayed so that a hit looks like a recompile.
+		if (auto it = std::find_if(cache.begin(), cache.end(), hit); it != cache.end()) {
+			std::rotate(it, it + 1, cache.end());
+
+			for (const Diagnostic& d: cache.back().result.diagnostics)
+				notify(d);
+
+			return cache.back().result;
+		}
+
+		struct Collector {
+			Engine& engine;
+			Result& result;
+		};
+
+		Result result;
+		Collector collector { *this, result };
+
+		Reporter reporter { [] (void* user, Reports kind, Phases phase, View original, View sv, std::string str) {
+			auto& [engine, result] = *static_cast<Collector*>(user);
+			Diagnostic& d = result.diagnostics.emplace_back();
+
+			d.kind = kind;
+			d.phase = phase;
+			d.message = std::move(str);
+
+			if (overlapping_intervals(original.begin, original.end, sv.begin, sv.end)) {
+				d.location = location(original, sv);
+				d.offset = sv.begin - original.begin;
+				d.length = sv.size();
+			}
+
+			engine.notify(d);
+		}, &collector };
+
+		try {
+			result.timeline = std::make_shared<const Timeline>(
+				cane::compile(src, reporter, stats ? &result.stats : nullptr, nullptr, cancel, budget)
+			);
+		}
+
+		catch (const Error&) {}
+
+		catch (const std::bad_alloc&) {
+			reporter(Reports::ERROR, Phases::INTERNAL, src, ""_sv, std::string { STR_NO_MEMORY.begin, STR_NO_MEMORY.end });
+		}
+
+		// Anything else is a bug but it still mustn't take the host down.
+		catch (const std::exception& e) {
+			std::ostringstream ss;
+			fmt(ss, STR_EXCEPTION, e.what());
+
+			reporter(Reports::ERROR, Phases::INTERNAL, src, ""_sv, ss.str());
+		}
+
+		catch (...) {
+			std::ostringstream ss;
+			fmt(ss, STR_EXCEPTION, "unknown"_sv);
+
+			reporter(Reports::ERROR, Phases::INTERNAL, src, ""_sv, ss.str());
+		}
+
+		// Not being able to cache a result doesn't make it any less valid.
+		if (result.ok() and cache_max != 0) {
+			if (cache.size() >= cache_max)
+				cache.erase(cache.begin(), cache.begin() + (cache.size() - cache_max + 1));
+
+			try {
+				cache.push_back({ hash, std::string { source }, stats, budget, result });
+			}
+
+			catch (const std::bad_alloc&) {}
+		}
+
+		return result;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef CANE_HISTOGRAM_HPP
+#define CANE_HISTOGRAM_HPP
+
+namespace cane {
+
+// Log-linear histogram in the style of HdrHistogram.
+// Every power of two is split into `2^HISTOGRAM_SUB_BITS` buckets so values
+// are kept to within ~3% of their true value across the whole 64-bit range.
+// Recording is a few integer operations and relaxed atomic stores so it can
+// be done from the realtime thread and read concurrently from another.
+// There must only be a single writer.
+
+constexpr size_t HISTOGRAM_SUB_BITS = 5u;
+
+struct Histogram {
+	static constexpr size_t SUB     = 1u << HISTOGRAM_SUB_BITS;
+	static constexpr size_t BUCKETS = (65u - HISTOGRAM_SUB_BITS) * SUB;
+
+	std::array<std::atomic<uint64_t>, BUCKETS> buckets {};
+
+	std::atomic<uint64_t> count = 0;
+	std::atomic<uint64_t> sum   = 0;
+	std::atomic<uint64_t> min   = UINT64_MAX;
+	std::atomic<uint64_t> max   = 0;
+
+	static constexpr size_t index(uint64_t v) {
+		if (v < SUB)
+			return v;
+
+		size_t exp = 63u - __builtin_clzll(v);
+		size_t shift = exp - HISTOGRAM_SUB_BITS;
+
+		return (shift + 1) * SUB + ((v >> shift) - SUB);
+	}
+
+	// Highest value that maps to the same bucket.
+	static constexpr uint64_t upper(size_t idx) {
+		if (idx < SUB)
+			return idx;
+
+		size_t shift = idx / SUB - 1;
+		uint64_t mantissa = idx % SUB + SUB;
+
+		return ((mantissa + 1) << shift) - 1;
+	}
+
+	inline void record(uint64_t v) {
+		auto relaxed = std::memory_order_relaxed;
+
+		buckets[index(v)].fetch_add(1, relaxed);
+
+		count.store(count.load(relaxed) + 1, relaxed);
+		sum.store(sum.load(relaxed) + v, relaxed);
+
+		if (v < min.load(relaxed)) min.store(v, relaxed);
+		if (v > max.load(relaxed)) max.store(v, relaxed);
+	}
+
+	inline uint64_t percentile(double p) const {
+		auto relaxed = std::memory_order_relaxed;
+
+		uint64_t total = 0;
+		for (auto& bucket: buckets)
+			total += bucket.load(relaxed);
+
+		if (total == 0)
+			return 0;
+
+		uint64_t target = std::max<uint64_t>(1, std::ceil(total * (p / 100.0)));
+		uint64_t seen = 0;
+
+		for (size_t i = 0; i != BUCKETS; ++i) {
+			seen += buckets[i].load(relaxed);
+
+			if (seen >= target)
+				return std::min(upper(i), max.load(relaxed));
+		}
+
+		return max.load(relaxed);
+	}
+
+	inline double mean() const {
+		uint64_t n = count.load(std::memory_order_relaxed);
+		return n == 0 ? 0.0 : static_cast<double>(sum.load(std::memory_order_relaxed)) / n;
+	}
+};
+
+static_assert(Histogram::index(Histogram::SUB - 1) == Histogram::SUB - 1);
+static_assert(Histogram::index(UINT64_MAX) == Histogram::BUCKETS - 1);
+static_assert(Histogram::upper(Histogram::index(1000)) >= 1000);
+
+}
+
+#endif
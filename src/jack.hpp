@@ -0,0 +1,220 @@
+#ifndef CANE_JACK_HPP
+#define CANE_JACK_HPP
+
+extern "C" {
+	#include <jack/jack.h>
+	#include <jack/midiport.h>
+	#include <jack/transport.h>
+	#include <jack/ringbuffer.h>
+}
+
+namespace cane {
+
+// JACK output backend, see `backend.hpp`.
+// Include after `lib.hpp`.
+
+struct jack_deleter {
+	template <typename T> constexpr void operator()(T arg) const {
+		jack_free(arg);
+	}
+};
+
+using JackPorts = std::unique_ptr<const char*[], jack_deleter>;
+
+struct JackBackend {
+	Player& player;
+
+	jack_client_t* client = nullptr;
+
+	std::array<jack_port_t*, PORT_MAX> ports {};
+	std::array<PortName, PORT_MAX> names {};
+	size_t nports = 0;
+
+	// Connect to JACK and register callbacks. Callbacks refer back to this
+	// object so it can't be moved.
+	inline JackBackend(Player& player_): player(player_) {
+		if (not (client = jack_client_open(CSTR_EXE, JackOptions::JackNoStartServer, nullptr)))
+			general_error(STR_CONNECT_ERROR);
+
+		// Sample rate changed callback. We use the sample rate to determine timing
+		// information so this is crucial.
+		if (jack_set_sample_rate_callback(client, [] (jack_nframes_t sample_rate, void* arg) {
+			JackBackend& jack = *static_cast<JackBackend*>(arg);
+			jack.player.sample_rate = sample_rate;
+			return 0;
+		}, static_cast<void*>(this)))
+			general_error(STR_SAMPLE_RATE_CALLBACK_ERROR);
+
+		// Notify of buffer size changes
+		if (jack_set_buffer_size_callback(client, [] (jack_nframes_t buffer_size, void* arg) {
+			JackBackend& jack = *static_cast<JackBackend*>(arg);
+			jack.player.buffer_size = buffer_size;
+			return 0;
+		}, static_cast<void*>(this)))
+			general_error(STR_BUFFER_SIZE_CALLBACK_ERROR);
+
+		// Count xruns for `--stats`.
+		if (jack_set_xrun_callback(client, [] (void* arg) {
+			JackBackend& jack = *static_cast<JackBackend*>(arg);
+			jack.player.stats.xruns.fetch_add(1, std::memory_order_relaxed);
+			return 0;
+		}, static_cast<void*>(this)))
+			general_error(STR_XRUN_CALLBACK_ERROR);
+
+		// The process thread can't allocate its trace buffer once running.
+		if (trace_enabled() and jack_set_thread_init_callback(client, [] (void*) {
+			trace_register_thread("jack"_sv);
+		}, nullptr))
+			general_error(STR_THREAD_INIT_CALLBACK_ERROR);
+
+		// MIDI out callback
+		if (jack_set_process_callback(client, [] (jack_nframes_t nframes, void *arg) {
+			JackBackend& jack = *static_cast<JackBackend*>(arg);
+			Period period { jack, nframes };
+
+			jack.player.process(period, nframes);
+
+			return 0;
+		}, static_cast<void*>(this)))
+			general_error(STR_PROCESS_CALLBACK_ERROR);
+
+		player.buffer_size = jack_get_buffer_size(client);
+		player.sample_rate = jack_get_sample_rate(client);
+	}
+
+	JackBackend(const JackBackend&) = delete;
+	JackBackend& operator=(const JackBackend&) = delete;
+
+	inline ~JackBackend() {
+		if (client != nullptr)
+			jack_deactivate(client);
+
+		for (size_t i = 0; i != nports; ++i)
+			jack_port_unregister(client, ports[i]);
+
+		if (client != nullptr)
+			jack_client_close(client);
+	}
+
+	// Port buffers for one process cycle.
+	struct Period {
+		JackBackend& jack;
+		std::array<void*, PORT_MAX> buffers {};
+
+		inline Period(JackBackend& jack_, jack_nframes_t nframes): jack(jack_) {
+			for (size_t i = 0; i != jack.nports; ++i) {
+				buffers[i] = jack_port_get_buffer(jack.ports[i], nframes);
+				jack_midi_clear_buffer(buffers[i]);
+			}
+		}
+
+		inline size_t ports() const {
+			return jack.nports;
+		}
+
+		inline uint8_t* reserve(uint8_t port, uint32_t offset, size_t size) {
+			return jack_midi_event_reserve(buffers[port], offset, size);
+		}
+
+		inline size_t room(uint8_t port) const {
+			return jack_midi_max_event_size(buffers[port]);
+		}
+
+		inline Transport transport() const {
+			jack_position_t pos {};
+			bool rolling = jack_transport_query(jack.client, &pos) == JackTransportRolling;
+
+			return { rolling, pos.frame };
+		}
+
+		inline size_t lost() const {
+			size_t lost = 0;
+
+			for (size_t i = 0; i != jack.nports; ++i)
+				lost += jack_midi_get_lost_event_count(buffers[i]);
+
+			return lost;
+		}
+	};
+
+	// Every MIDI input port matching `device`.
+	inline JackPorts destinations(const std::string& device) {
+		JackPorts dests { jack_get_ports(client, device.c_str(), JACK_DEFAULT_MIDI_TYPE, JackPortIsInput) };
+
+		if (not dests)  // Error occured
+			general_error(STR_GET_PORTS_ERROR);
+
+		if (not dests[0])  // No MIDI input ports.
+			general_error(STR_NOT_FOUND, device);
+
+		return dests;
+	}
+
+	// Register a port by name unless it already is, returns its index.
+	// Ports can be declared before the timeline is known so that they can
+	// be connected while it's still compiling.
+	inline size_t declare(const PortName& name) {
+		for (size_t i = 0; i != nports; ++i) {
+			if (std::string_view { names[i].data() } == std::string_view { name.data() })
+				return i;
+		}
+
+		if (nports == PORT_MAX)
+			general_error(STR_PORT_ERROR);
+
+		if (not (ports[nports] = jack_port_register(client, name.data(), JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0)))
+			general_error(STR_PORT_ERROR);
+
+		names[nports] = name;
+		return nports++;
+	}
+
+	// Order ports the way the timeline indexes them, registering any it
+	// uses that weren't declared. Every declared port should be one of
+	// `timeline`.
+	inline void open(const std::vector<PortName>& timeline) {
+		std::array<jack_port_t*, PORT_MAX> order {};
+		std::bitset<PORT_MAX> used;
+
+		for (size_t i = 0; i != std::min(timeline.size(), PORT_MAX); ++i) {
+			size_t port = declare(timeline[i]);
+
+			// Names in a mapped timeline aren't checked for duplicates.
+			if (used.test(port))
+				general_error(STR_PORT_ERROR);
+
+			order[i] = ports[port];
+			used.set(port);
+		}
+
+		for (size_t i = 0; i != nports; ++i)
+			names[i] = timeline[i];
+
+		ports = order;
+	}
+
+	inline void connect(size_t port, const char* dest) {
+		if (jack_connect(client, jack_port_name(ports[port]), dest))
+			general_error(STR_PATCH_ERROR, dest);
+	}
+
+	// Priority of the thread running the process callback, 0 unless JACK
+	// is running realtime.
+	inline int priority() const {
+		return std::max(jack_client_real_time_priority(client), 0);
+	}
+
+	inline size_t buffer_bytes() const {
+		return jack_port_type_get_buffer_size(client, JACK_DEFAULT_MIDI_TYPE);
+	}
+
+	// Call this or else our callback is never called.
+	inline void activate() {
+		if (jack_activate(client))
+			general_error(STR_ACTIVATE_ERROR);
+	}
+};
+
+}
+
+#endif
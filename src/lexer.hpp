@@ -3,6 +3,123 @@
 
 namespace cane {
 
+// Take the next token off the front of `src`. Kept free of any state so
+// that it can also run in constant expressions, see `static.hpp`. Returns a
+// token of kind `NONE` if there is no valid token.
+constexpr Token lex_token(View& src) {
+	Token tok {};
+
+	auto& [view, kind] = tok;
+
+	// Skip whitespace and comments.
+	while (true) {
+		static_cast<void>(cane::take_while(src, [] (View sv) {
+			return cane::is_whitespace(decode(sv));
+		}));
+
+		if (cane::peek(src) != "#"_sv)
+			break;
+
+		static_cast<void>(cane::take_while(src, [] (View sv) {
+			return sv != "\n"_sv;
+		}));
+	}
+
+	view = cane::peek(src);
+
+	if (src.empty()) {
+		kind = Symbols::TERMINATOR;
+	}
+
+	else if (view == "("_sv) { kind = Symbols::LPAREN; src = cane::next(src); }
+	else if (view == ")"_sv) { kind = Symbols::RPAREN; src = cane::next(src); }
+
+	else if (view == "!"_sv) { kind = Symbols::BEAT; src = cane::next(src); }
+	else if (view == "."_sv) { kind = Symbols::SKIP; src = cane::next(src); }
+	else if (view == ":"_sv) { kind = Symbols::SEP;  src = cane::next(src); }
+
+	else if (view == "?"_sv) { kind = Symbols::DBG;    src = cane::next(src); }
+	else if (view == "~"_sv) { kind = Symbols::INVERT; src = cane::next(src); }
+	else if (view == "'"_sv) { kind = Symbols::REV;    src = cane::next(src); }
+	else if (view == ","_sv) { kind = Symbols::CAT;    src = cane::next(src); }
+
+	else if (view == "+"_sv) { kind = Symbols::ADD; src = cane::next(src); }
+	else if (view == "-"_sv) { kind = Symbols::SUB; src = cane::next(src); }
+	else if (view == "/"_sv) { kind = Symbols::DIV; src = cane::next(src); }
+
+	else if (view == "<"_sv) { kind = Symbols::ROTL; src = cane::next(src); }
+	else if (view == ">"_sv) { kind = Symbols::ROTR; src = cane::next(src); }
+
+	else if (view == "@"_sv) { kind = Symbols::BPM;  src = cane::next(src); }
+	else if (view == "$"_sv) { kind = Symbols::WITH; src = cane::next(src); }
+
+	else if (view == "*"_sv) {
+		kind = Symbols::MUL;
+		src = cane::next(src);
+
+		if (cane::peek(src) == "*"_sv) {
+			kind = Symbols::REP;
+			view = encompass(view, cane::peek(src));
+			src = cane::next(src);
+		}
+	}
+
+	// Doubled, these are the polymetric `||`, `&&` and `^^`.
+	else if (view == "|"_sv or view == "&"_sv or view == "^"_sv) {
+		bool poly = cane::peek(cane::next(src)) == view;
+
+		if      (view == "|"_sv) kind = poly ? Symbols::POLY_OR  : Symbols::OR;
+		else if (view == "&"_sv) kind = poly ? Symbols::POLY_AND : Symbols::AND;
+		else                     kind = poly ? Symbols::POLY_XOR : Symbols::XOR;
+
+		src = cane::next(src);
+
+		if (poly) {
+			view = encompass(view, cane::peek(src));
+			src = cane::next(src);
+		}
+	}
+
+	// The kind is left as NONE if `=` isn't followed by `>`.
+	else if (view == "="_sv) {
+		src = cane::next(src);
+
+		if (cane::peek(src) == ">"_sv) {
+			kind = Symbols::CHAIN;
+			view = encompass(view, cane::peek(src));
+			src = cane::next(src);
+		}
+	}
+
+	else if (cane::is_number(decode(cane::peek(src)))) {
+		kind = Symbols::INT;
+		view = cane::take_while(src, [] (View sv) {
+			return cane::is_number(decode(sv));
+		});
+	}
+
+	else if (cane::is_letter(decode(cane::peek(src))) or view == "_"_sv) {
+		kind = Symbols::IDENT;
+		view = cane::take_while(src, [] (View sv) {
+			return cane::is_alphanumeric(decode(sv)) or sv == "_"_sv;
+		});
+
+		if      (view == "map"_sv)   kind = Symbols::MAP;
+		else if (view == "send"_sv)  kind = Symbols::SEND;
+		else if (view == "alias"_sv) kind = Symbols::ALIAS;
+		else if (view == "len"_sv)   kind = Symbols::LEN_OF;
+		else if (view == "let"_sv)   kind = Symbols::LET;
+		else if (view == "tempo"_sv) kind = Symbols::TEMPO;
+		else if (view == "port"_sv)  kind = Symbols::PORT;
+		else if (view == "car"_sv)   kind = Symbols::CAR;
+		else if (view == "cdr"_sv)   kind = Symbols::CDR;
+		else if (view == "bpm"_sv)   kind = Symbols::GLOBAL_BPM;
+		else if (view == "note"_sv)  kind = Symbols::GLOBAL_NOTE;
+	}
+
+	return tok;
+}
+
 struct Lexer {
 	Context& ctx;
 
@@ -23,7 +140,7 @@ struct Lexer {
 		std::ostringstream ss;
 		fmt(ss, std::forward<Ts>(args)...);
 
-		ctx.error_handler(Phases::SYNTACTIC, original, sv, ss.str());
+		ctx.reporter(Reports::ERROR, Phases::SYNTACTIC, original, sv, ss.str());
 
 		throw Error {};
 	}
@@ -32,7 +149,7 @@ struct Lexer {
 	[[noreturn]] inline void error(Context& ctx, Phases phase, View sv, Ts&&... args) {
 		std::ostringstream ss;
 		fmt(ss, std::forward<Ts>(args)...);
-		ctx.error_handler(phase, original, sv, ss.str());
+		ctx.reporter(Reports::ERROR, phase, original, sv, ss.str());
 		throw Error {};
 	}
 
@@ -40,119 +157,30 @@ struct Lexer {
 	inline void warning(Context& ctx, Phases phase, View sv, Ts&&... args) {
 		std::ostringstream ss;
 		fmt(ss, std::forward<Ts>(args)...);
-		ctx.warning_handler(phase, original, sv, ss.str());
+		ctx.reporter(Reports::WARNING, phase, original, sv, ss.str());
 	}
 
 	template <typename... Ts>
 	inline void notice(Context& ctx, Phases phase, View sv, Ts&&... args) {
 		std::ostringstream ss;
 		fmt(ss, std::forward<Ts>(args)...);
-		ctx.notice_handler(phase, original, sv, ss.str());
+		ctx.reporter(Reports::NOTICE, phase, original, sv, ss.str());
 	}
 
 	inline Token next() {
-		Token tok {};
-
-		auto& [sbegin, send] = src;
-		auto& [view, kind] = tok;
-		auto& [begin, end] = view;
-
-		// Skip whitespace.
-		View ws = cane::take_while(src, [] (View sv) {
-			return cane::is_whitespace(decode(sv));
-		});
-
-		view = cane::peek(src);
-
-		if (src.empty()) {
-			kind = Symbols::TERMINATOR;
-		}
-
-		else if (cane::peek(src) == "#"_sv) {
-			view = cane::take_while(src, [] (View sv) {
-				return sv != "\n"_sv;
-			});
-
-			return next();
-		}
+		StatTimer timer { ctx.stats, ctx.stats.lexing };
+		ctx.stats.tokens++;
 
-		else if (view == "("_sv) { kind = Symbols::LPAREN; src = cane::next(src); }
-		else if (view == ")"_sv) { kind = Symbols::RPAREN; src = cane::next(src); }
-
-		else if (view == "!"_sv) { kind = Symbols::BEAT; src = cane::next(src); }
-		else if (view == "."_sv) { kind = Symbols::SKIP; src = cane::next(src); }
-		else if (view == ":"_sv) { kind = Symbols::SEP;  src = cane::next(src); }
-
-		else if (view == "?"_sv) { kind = Symbols::DBG;    src = cane::next(src); }
-		else if (view == "~"_sv) { kind = Symbols::INVERT; src = cane::next(src); }
-		else if (view == "'"_sv) { kind = Symbols::REV;    src = cane::next(src); }
-		else if (view == "|"_sv) { kind = Symbols::OR;     src = cane::next(src); }
-		else if (view == "^"_sv) { kind = Symbols::XOR;    src = cane::next(src); }
-		else if (view == ","_sv) { kind = Symbols::CAT;    src = cane::next(src); }
-
-		else if (view == "+"_sv) { kind = Symbols::ADD; src = cane::next(src); }
-		else if (view == "-"_sv) { kind = Symbols::SUB; src = cane::next(src); }
-		else if (view == "/"_sv) { kind = Symbols::DIV; src = cane::next(src); }
-		else if (view == "&"_sv) { kind = Symbols::AND; src = cane::next(src); }
-
-		else if (view == "<"_sv) { kind = Symbols::ROTL; src = cane::next(src); }
-		else if (view == ">"_sv) { kind = Symbols::ROTR; src = cane::next(src); }
-
-		else if (view == "@"_sv) { kind = Symbols::BPM;  src = cane::next(src); }
-		else if (view == "$"_sv) { kind = Symbols::WITH; src = cane::next(src); }
-
-		else if (view == "*"_sv) {
-			kind = Symbols::MUL;
-			src = cane::next(src);
-
-			if (cane::peek(src) == "*"_sv) {
-				kind = Symbols::REP;
-				view = encompass(view, cane::peek(src));
-				src = cane::next(src);
-			}
-		}
-
-		else if (view == "="_sv) {
-			src = cane::next(src);
-
-			if (cane::peek(src) == ">"_sv) {
-				kind = Symbols::CHAIN;
-				view = encompass(view, cane::peek(src));
-				src = cane::next(src);
-			}
-		}
-
-		else if (cane::is_number(decode(cane::peek(src)))) {
-			kind = Symbols::INT;
-			view = cane::take_while(src, [] (View sv) {
-				return cane::is_number(decode(sv));
-			});
-		}
+		return lex();
+	}
 
-		else if (cane::is_letter(decode(cane::peek(src))) or view == "_"_sv) {
-			kind = Symbols::IDENT;
-			view = cane::take_while(src, [] (View sv) {
-				return cane::is_alphanumeric(decode(sv)) or sv == "_"_sv;
-			});
-
-			if      (view == "map"_sv)   kind = Symbols::MAP;
-			else if (view == "send"_sv)  kind = Symbols::SEND;
-			else if (view == "alias"_sv) kind = Symbols::ALIAS;
-			else if (view == "len"_sv)   kind = Symbols::LEN_OF;
-			else if (view == "let"_sv)   kind = Symbols::LET;
-			else if (view == "car"_sv)   kind = Symbols::CAR;
-			else if (view == "cdr"_sv)   kind = Symbols::CDR;
-			else if (view == "bpm"_sv)   kind = Symbols::GLOBAL_BPM;
-			else if (view == "note"_sv)  kind = Symbols::GLOBAL_NOTE;
-		}
+	inline Token lex() {
+		Token tok = lex_token(src);
 
 		// If the kind is still NONE by this point, we can assume we didn't find
-		// a valid token. The reason this check is disconnected from the above
-		// if-else chain is because some checks are nested and only fail after
-		// succeeding with the original check so we wouldn't fall through if this
-		// check was connected.
-		if (kind == Symbols::NONE)
-			error(ctx, Phases::LEXICAL, view, STR_UNKNOWN_CHAR, view);
+		// a valid token.
+		if (tok.kind == Symbols::NONE)
+			error(ctx, Phases::LEXICAL, tok.view, STR_UNKNOWN_CHAR, tok.view);
 
 		Token out = peek;
 
@@ -4,8 +4,22 @@
 #include <utility>
 #include <iostream>
 #include <sstream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <filesystem>
 #include <vector>
 #include <array>
+#include <bitset>
+#include <optional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <limits>
+#include <iomanip>
 #include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
@@ -15,6 +29,13 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
 #include <unicode_internal.hpp>
 #include <unicode.hpp>
 #include <util.hpp>
@@ -24,11 +45,27 @@
 #include <unicode.hpp>
 #include <log.hpp>
 #include <report.hpp>
+#include <trace.hpp>
+#include <histogram.hpp>
 
 #include <constants.hpp>
 #include <types.hpp>
+#include <tempo.hpp>
+#include <realtime.hpp>
+#include <parallel.hpp>
 #include <ops.hpp>
 #include <lexer.hpp>
 #include <compile.hpp>
+#include <static.hpp>
+#include <smf.hpp>
+#include <cache.hpp>
+#include <engine.hpp>
+#include <spill.hpp>
+#include <bucket.hpp>
+#include <seek.hpp>
+#include <loop.hpp>
+#include <capacity.hpp>
+#include <player.hpp>
+#include <backend.hpp>
 
 #endif
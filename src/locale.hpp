@@ -11,6 +11,8 @@ namespace cane {
 
 	constexpr View STR_ENCODING    = "malformed source encoding"_sv;
 	constexpr View STR_UNREACHABLE = "unreachable code `%`"_sv;
+	constexpr View STR_NO_MEMORY   = "out of memory"_sv;
+	constexpr View STR_EXCEPTION   = "unexpected exception `%`"_sv;
 
 	constexpr View STR_SECOND_SUFFIX = "s"_sv;
 	constexpr View STR_MILLI_SUFFIX  = "ms"_sv;
@@ -43,12 +45,19 @@ namespace cane {
 	constexpr View STR_STATEMENT = "expecting a statement"_sv;
 	constexpr View STR_META      = "expecting metadata"_sv;
 
-	constexpr View STR_EXPECT       = "expecting `%`"_sv;
-	constexpr View STR_UNKNOWN_CHAR = "unknown character `%`"_sv;
-	constexpr View STR_NOT_NUMBER   = "invalid digit `%`"_sv;
-	constexpr View STR_EMPTY        = "empty sequence"_sv;
-	constexpr View STR_NO_BPM       = "no global tempo specified"_sv;
-	constexpr View STR_NO_NOTE      = "no global base note specified"_sv;
+	constexpr View STR_EXPECT        = "expecting `%`"_sv;
+	constexpr View STR_UNKNOWN_CHAR  = "unknown character `%`"_sv;
+	constexpr View STR_NOT_NUMBER    = "invalid digit `%`"_sv;
+	constexpr View STR_EMPTY         = "empty sequence"_sv;
+	constexpr View STR_NO_BPM        = "no global tempo specified"_sv;
+	constexpr View STR_NO_NOTE       = "no global base note specified"_sv;
+	constexpr View STR_PORT_MAX      = "no more than `%` ports can be declared"_sv;
+	constexpr View STR_PORT_NAME     = "port names can be at most `%` bytes"_sv;
+	constexpr View STR_STATIC_TEMPO  = "tempo changes are not supported in static patterns"_sv;
+	constexpr View STR_STATIC_LIMIT  = "static pattern exceeds a fixed capacity"_sv;
+	constexpr View STR_POLY_LENGTH   = "polymeter is too long"_sv;
+	constexpr View STR_BUDGET_STEPS  = "`%` steps on top of `%` bytes held would exceed the memory budget of `%` bytes"_sv;
+	constexpr View STR_BUDGET_EVENTS = "`%` events on top of `%` bytes held would exceed the budget of `%` events or `%` bytes"_sv;
 
 	constexpr View STR_UNDEFINED = "`%` is undefined"_sv;
 	constexpr View STR_REDEFINED = "`%` has been re-defined"_sv;
@@ -67,6 +76,8 @@ namespace cane {
 	constexpr View STR_PORT_REGISTRATION_CALLBACK_ERROR = "could not register port registration callback"_sv;
 	constexpr View STR_PORT_CONNECT_CALLBACK_ERROR      = "could not register port connect callback"_sv;
 	constexpr View STR_BUFFER_SIZE_CALLBACK_ERROR       = "could not register buffer size callback"_sv;
+	constexpr View STR_THREAD_INIT_CALLBACK_ERROR       = "could not register thread init callback"_sv;
+	constexpr View STR_XRUN_CALLBACK_ERROR              = "could not register xrun callback"_sv;
 
 	constexpr View STR_BUFFER_SIZE_CHANGE = "buffer size changed from `%` to `%` frames"_sv;
 	constexpr View STR_PORT_CONNECT       = "port `%` connected to port `%`"_sv;
@@ -75,6 +86,16 @@ namespace cane {
 	constexpr View STR_PORT_RENAME        = "port `%` was renamed to `%`"_sv;
 	constexpr View STR_SAMPLE_RATE_CHANGE = "sample rate was changed from `%` to `%`Hz"_sv;
 	constexpr View STR_LOST_EVENT         = "`%` MIDI event(s) lost"_sv;
+	constexpr View STR_MLOCK_ERROR        = "could not lock playback into memory, raise the locked memory limit (`ulimit -l`)"_sv;
+	constexpr View STR_THREAD_POLICY      = "could not apply scheduling to the `%` thread"_sv;
+	constexpr View STR_THREAD_PRIORITY    = "`%` thread priority lowered to `%` to stay below JACK's `%`"_sv;
+	constexpr View STR_LATE_EVENT         = "`%` MIDI event(s) played late"_sv;
+	constexpr View STR_SMF_TEMPO          = "`%` tempo change(s) slower than a MIDI file can hold were written as `%` BPM"_sv;
+	constexpr View STR_STATIC_MISMATCH    = "static pattern `%` differs from `compile` at event `%`"_sv;
+	constexpr View STR_RATE_INEXACT       = "no exact time grid for `%` BPM alongside the others in use, steps will be rounded"_sv;
+	constexpr View STR_CAPACITY           = "`%` event(s) (`%` bytes) due in one period between `%`s and `%`s but the port buffer holds `%` bytes, the excess will be delayed"_sv;
+	constexpr View STR_CAPACITY_MORE      = "`%` more period(s) exceed the port buffer"_sv;
+	constexpr View STR_CAPACITY_PEAK      = "busiest period has `%` event(s) (`%` of `%` bytes) at `%`s"_sv;
 	constexpr View STR_NO_DEVICE          = "no MIDI device specified"_sv;
 	constexpr View STR_DEVICE             = "device `%`"_sv;
 	constexpr View STR_FOUND              = "found port `%`"_sv;
@@ -83,13 +104,43 @@ namespace cane {
 	constexpr View STR_PORT_ERROR         = "could not register port"_sv;
 	constexpr View STR_WRITE_ERROR        = "could not send MIDI event"_sv;
 	constexpr View STR_ACTIVATE_ERROR     = "could not activate JACK client"_sv;
+	constexpr View STR_BUFFER_SIZE_ERROR  = "could not set the buffer size to `%` frames"_sv;
 	constexpr View STR_GET_PORTS_ERROR    = "could not get MIDI input ports from JACK"_sv;
 	constexpr View STR_PATCH_ERROR        = "could not connect to port `%`"_sv;
+	constexpr View STR_PORT_UNDECLARED    = "port `%` is not declared"_sv;
+
+	constexpr View STR_STATS_PHASE  = "% took `%`ms"_sv;
+	constexpr View STR_STATS_TOKENS = "`%` token(s) lexed"_sv;
+	constexpr View STR_STATS_STEPS  = "`%` sequence step(s) materialized"_sv;
+	constexpr View STR_STATS_EVENTS = "`%` event(s) in timeline"_sv;
+	constexpr View STR_STATS_ALLOCS = "`%` allocation(s) totalling `%` bytes"_sv;
+	constexpr View STR_STATS_MEMORY = "peak memory usage `%`KiB"_sv;
+
+	constexpr View STR_STATS_LEXING    = "lexing"_sv;
+	constexpr View STR_STATS_PARSING   = "parsing and evaluation"_sv;
+	constexpr View STR_STATS_COMPILING = "sequence compilation"_sv;
+	constexpr View STR_STATS_REALTIME  = "clock and sensing generation"_sv;
+	constexpr View STR_STATS_SORTING   = "sorting"_sv;
+	constexpr View STR_STATS_BOOKEND   = "start/stop and reset insertion"_sv;
+	constexpr View STR_STATS_TOTAL     = "compilation"_sv;
+
+	constexpr View STR_HISTOGRAM          = "% p50 `%` p90 `%` p99 `%` p99.9 `%` max `%` over `%` cycle(s)"_sv;
+	constexpr View STR_HISTOGRAM_CALLBACK = "callback time (µs)"_sv;
+	constexpr View STR_HISTOGRAM_EVENTS   = "events per cycle"_sv;
+	constexpr View STR_SPILL_SUMMARY      = "`%` event(s) spilled, `%` dropped, `%` note-on(s) cancelled"_sv;
+	constexpr View STR_PLAYER_SUMMARY     = "`%` xrun(s), `%` lost event(s), `%` render underrun(s), period deadline `%`µs"_sv;
+
+	constexpr View STR_LOOPING            = "looping"_sv;
+
+	constexpr View STR_TRACE_DROPPED  = "`%` earlier trace record(s) on thread `%` were overwritten"_sv;
+	constexpr View STR_TRACE_DISABLED = "tracing was disabled at compile time"_sv;
 
 	constexpr View STR_SYMLINK_ERROR        = "symlink `%` resolves to itself"_sv;
 	constexpr View STR_NOT_FILE_ERROR       = "`%` is not a file"_sv;
 	constexpr View STR_FILE_NOT_FOUND_ERROR = "file `%` not found"_sv;
 	constexpr View STR_FILE_READ_ERROR      = "cannot read `%`"_sv;
+	constexpr View STR_FILE_WRITE_ERROR     = "cannot write `%`"_sv;
+	constexpr View STR_CACHE_INVALID        = "`%` is not a timeline compiled by this version"_sv;
 
 }
 
@@ -0,0 +1,152 @@
+#ifndef CANE_LOOP_HPP
+#define CANE_LOOP_HPP
+
+namespace cane {
+
+// Polymetric looping.
+// Rather than laying every send out once on a timeline, each send can loop
+// forever at its own length and BPM. Nothing is expanded: a loop keeps its
+// steps and a cursor, and where it is at any frame is worked out with
+// integer arithmetic on the frame clock, so loops of coprime lengths stay
+// aligned indefinitely in memory proportional to the sum of their lengths.
+
+constexpr size_t LOOP_EVENT_CAPACITY = 1u << 10;  // Events per period.
+
+// Frame at which step `k` of something running at `rate` steps per minute
+// starts. Computed from `k` directly so there is no accumulated error.
+constexpr uint64_t step_frame(uint64_t k, uint64_t rate, uint64_t sample_rate) {
+	return k * 60u * sample_rate / rate;
+}
+
+// First step starting at or after `frame`.
+constexpr uint64_t step_at(uint64_t frame, uint64_t rate, uint64_t sample_rate) {
+	uint64_t k = frame * rate / (60u * sample_rate);
+	return step_frame(k, rate, sample_rate) < frame ? k + 1 : k;
+}
+
+struct LoopCursor {
+	uint64_t step = 0;  // Next step boundary to play.
+	uint64_t frame = 0; // Frame at which it starts.
+};
+
+struct LoopEvent {
+	uint32_t offset;
+	uint32_t order;  // Emission order, breaks ties.
+	MidiEvent ev;
+};
+
+struct LoopEngine {
+	std::vector<Loop> loops;
+	std::vector<LoopCursor> cursors;
+
+	uint64_t bpm = BPM_DEFAULT;  // Tempo of the MIDI clock.
+	LoopCursor clock;
+
+	bool started = false;  // START has been sent.
+
+	// Scratch space for one period so nothing is allocated while playing.
+	std::vector<LoopEvent> pending;
+
+	inline LoopEngine() {}
+
+	inline LoopEngine(std::vector<Loop> loops_, uint64_t bpm_):
+		loops(std::move(loops_)), bpm(bpm_)
+	{
+		// Nothing to loop over.
+		loops.erase(std::remove_if(loops.begin(), loops.end(), [] (const Loop& loop) {
+			return loop.seq.empty() or loop.seq.bpm == 0;
+		}), loops.end());
+
+		cursors.resize(loops.size());
+		pending.reserve(LOOP_EVENT_CAPACITY);
+	}
+
+	// Jump to `frame`. Cursors are recomputed from scratch which makes
+	// this as cheap as playing from the start.
+	inline void seek(uint64_t frame, uint64_t sample_rate) {
+		for (size_t i = 0; i != loops.size(); ++i) {
+			uint64_t k = step_at(frame, loops[i].seq.bpm, sample_rate);
+			cursors[i] = { k, step_frame(k, loops[i].seq.bpm, sample_rate) };
+		}
+
+		uint64_t k = step_at(frame, bpm * CLOCK_PPQ, sample_rate);
+		clock = { k, step_frame(k, bpm * CLOCK_PPQ, sample_rate) };
+	}
+
+	// Produce every event due in `[frame, frame + frames)` and hand them
+	// to `write(event, offset)` in order. Returns the number of events that
+	// couldn't be written.
+	template <typename F>
+	inline size_t process(uint64_t frame, uint32_t frames, uint64_t sample_rate, F&& write) {
+		uint64_t limit = frame + frames;
+		uint32_t order = 0;
+		size_t dropped = 0;
+
+		pending.clear();
+
+		auto emit = [&] (uint64_t at, uint8_t status, uint8_t note, uint8_t velocity, uint8_t port) {
+			if (pending.size() == LOOP_EVENT_CAPACITY) {
+				dropped++;
+				return;
+			}
+
+			uint32_t offset = at > frame ? at - frame : 0u;
+			pending.push_back({ offset, order++, { 0, status, note, velocity, port } });
+		};
+
+		if (not started) {
+			emit(frame, midi2int(Midi::START), 0, 0, PORT_ALL);
+			started = true;
+		}
+
+		for (; clock.frame < limit; clock.frame = step_frame(++clock.step, bpm * CLOCK_PPQ, sample_rate))
+			emit(clock.frame, midi2int(Midi::TIMING_CLOCK), 0, 0, PORT_ALL);
+
+		for (size_t i = 0; i != loops.size(); ++i) {
+			auto& [seq, chan] = loops[i];
+			LoopCursor& cur = cursors[i];
+
+			uint8_t on = midi2int(Midi::NOTE_ON) | chan.chan;
+			uint8_t off = midi2int(Midi::NOTE_OFF) | chan.chan;
+
+			for (; cur.frame < limit; cur.frame = step_frame(++cur.step, seq.bpm, sample_rate)) {
+				// The previous step's note ends where this one starts.
+				if (cur.step != 0) {
+					const Event& prev = seq[(cur.step - 1) % seq.size()];
+
+					if (prev.kind == BEAT)
+						emit(cur.frame, off, prev.note, VELOCITY_DEFAULT, chan.port);
+				}
+
+				const Event& step = seq[cur.step % seq.size()];
+
+				if (step.kind == BEAT)
+					emit(cur.frame, on, step.note, VELOCITY_DEFAULT, chan.port);
+			}
+		}
+
+		// Loops interleave so restore order by offset. At the same offset
+		// every note-off goes first so one loop can't cut off a note another
+		// loop has just started.
+		std::sort(pending.begin(), pending.end(), [] (const LoopEvent& a, const LoopEvent& b) {
+			auto pa = spill_priority(a.ev);
+			auto pb = spill_priority(b.ev);
+
+			return
+				a.offset != b.offset ? a.offset < b.offset :
+				pa != pb ? pa < pb :
+				a.order < b.order;
+		});
+
+		for (const LoopEvent& e: pending) {
+			if (not write(e.ev, e.offset))
+				dropped++;
+		}
+
+		return dropped;
+	}
+};
+
+}
+
+#endif
@@ -28,43 +28,84 @@ constexpr bool operator!=(Event lhs, Event rhs) {
 	return not(lhs == rhs);
 }
 
-// Identifies repeating pattern in a sequence
-// and attempts to minify it so we don't spam
-// the stdout for large sequences.
-inline decltype(auto) sequence_minify(Sequence seq) {
-	for (size_t f = 1; f != seq.size(); ++f) {
-		if (seq.size() % f != 0)
-			continue;
+// Steps that would play back the same, unlike `==` which only looks at
+// whether they are beats.
+constexpr bool step_identical(Event lhs, Event rhs) {
+	return lhs.kind == rhs.kind and lhs.note == rhs.note;
+}
 
-		bool all_eq = false;
-		for (size_t i = 1; i != (seq.size() / f); ++i) {
-			all_eq = std::equal(seq.begin(), seq.begin() + f, seq.begin() + (f * i));
+// Length of the shortest block that `[first, last)` is a whole number of
+// repeats of. The prefix function gives the shortest period in linear time
+// and if that doesn't divide the length then no shorter block does either.
+template <typename It, typename F>
+inline size_t period(It first, It last, F&& eq) {
+	size_t n = last - first;
 
-			if (not all_eq)
-				break;
-		}
+	if (n == 0)
+		return 0;
 
-		if (all_eq) {
-			seq.erase(seq.begin() + f, seq.end());
-			return seq;
-		}
+	std::vector<size_t> prefix(n, 0u);
+
+	for (size_t i = 1; i != n; ++i) {
+		size_t k = prefix[i - 1];
+
+		while (k != 0 and not eq(first[i], first[k]))
+			k = prefix[k - 1];
+
+		if (eq(first[i], first[k]))
+			k++;
+
+		prefix[i] = k;
 	}
 
-	return seq;
+	size_t p = n - prefix[n - 1];
+	return n % p == 0 ? p : n;
+}
+
+template <typename F = std::equal_to<>>
+inline size_t sequence_period(const Sequence& seq, F&& eq = {}) {
+	return period(seq.begin(), seq.end(), std::forward<F>(eq));
+}
+
+// Step `i` of `beats` spread as evenly as they go over `steps`.
+constexpr Event euclid_step(uint64_t i, uint64_t beats, uint64_t steps) {
+	return { static_cast<uint8_t>((i * beats) % steps < beats) };
+}
+
+// Identifies repeating pattern in a sequence
+// and attempts to minify it so we don't spam
+// the stdout for large sequences.
+template <typename F = std::equal_to<>>
+inline Sequence sequence_minify(const Sequence& seq, F&& eq = {}) {
+	Sequence mini;
+
+	mini.bpm = seq.bpm;
+	mini.assign(seq.begin(), seq.begin() + sequence_period(seq, std::forward<F>(eq)));
+
+	return mini;
 }
 
 inline decltype(auto) sequence_repeat(Sequence seq, size_t n = 1) {
 	// Copy sequence N times to the end of itself.
 	// turns i.e. `[a b c]` where N=3 into `[a b c a b c a b c]`.
 
-	if (n == 0)
+	if (n == 0 or seq.empty())
 		return seq;
 
 	size_t count = seq.size();
-	seq.reserve(seq.capacity() + n * count);
+	seq.resize(count * n);
+
+	// Every copy after the first is filled in from the first, chunks start
+	// partway through a copy and carry on into the next.
+	parallel_for(count * (n - 1), [&] (size_t begin, size_t end) {
+		for (size_t i = begin; i != end;) {
+			size_t k = i % count;
+			size_t len = std::min(count - k, end - i);
 
-	while (--n)
-		std::copy_n(seq.begin(), count, std::back_inserter(seq));
+			std::copy_n(seq.begin() + k, len, seq.begin() + count + i);
+			i += len;
+		}
+	});
 
 	return seq;
 }
@@ -85,7 +126,10 @@ inline decltype(auto) sequence_rotr(Sequence seq, size_t n = 1) {
 }
 
 inline decltype(auto) sequence_invert(Sequence seq) {
-	std::transform(seq.begin(), seq.end(), seq.begin(), std::logical_not<>{});
+	parallel_for(seq.size(), [&] (size_t begin, size_t end) {
+		std::transform(seq.begin() + begin, seq.begin() + end, seq.begin() + begin, std::logical_not<>{});
+	});
+
 	return seq;
 }
 
@@ -94,21 +138,113 @@ inline decltype(auto) sequence_cat(Sequence lhs, Sequence rhs) {
 	return lhs;
 }
 
+// Only as many steps as both have are combined, the rest of `lhs` is
+// left as it is and the rest of `rhs` is dropped.
 inline decltype(auto) sequence_or(Sequence lhs, Sequence rhs) {
-	std::transform(rhs.cbegin(), rhs.cend(), lhs.begin(), lhs.begin(), std::bit_or<>{});
+	parallel_for(std::min(lhs.size(), rhs.size()), [&] (size_t begin, size_t end) {
+		std::transform(rhs.cbegin() + begin, rhs.cbegin() + end, lhs.begin() + begin, lhs.begin() + begin, std::bit_or<>{});
+	});
+
 	return lhs;
 }
 
 inline decltype(auto) sequence_and(Sequence lhs, Sequence rhs) {
-	std::transform(rhs.cbegin(), rhs.cend(), lhs.begin(), lhs.begin(), std::bit_and<>{});
+	parallel_for(std::min(lhs.size(), rhs.size()), [&] (size_t begin, size_t end) {
+		std::transform(rhs.cbegin() + begin, rhs.cbegin() + end, lhs.begin() + begin, lhs.begin() + begin, std::bit_and<>{});
+	});
+
 	return lhs;
 }
 
 inline decltype(auto) sequence_xor(Sequence lhs, Sequence rhs) {
-	std::transform(rhs.cbegin(), rhs.cend(), lhs.begin(), lhs.begin(), std::bit_xor<>{});
+	parallel_for(std::min(lhs.size(), rhs.size()), [&] (size_t begin, size_t end) {
+		std::transform(rhs.cbegin() + begin, rhs.cbegin() + end, lhs.begin() + begin, lhs.begin() + begin, std::bit_xor<>{});
+	});
+
 	return lhs;
 }
 
+// Polymetric combination.
+// `a || b` cycles `a` and `b` each at their own length until they line up
+// again, so the result is as long as the LCM of both. Rather than being
+// expanded, `b` is kept as a layer over `a` and step `i` is worked out on
+// demand from step `i` modulo the length of every operand. `7:13 || 5:11`
+// holds 24 steps instead of 143 until something needs them one by one.
+constexpr Event layer_combine(Symbols op, Event lhs, Event rhs) {
+	switch (op) {
+		case Symbols::POLY_OR:  return rhs | lhs;
+		case Symbols::POLY_AND: return rhs & lhs;
+		default: break;
+	}
+
+	return rhs ^ lhs;
+}
+
+// Length of a sequence counting its layers, zero if any operand is empty.
+inline size_t sequence_len(const Sequence& seq) {
+	size_t n = seq.size();
+
+	for (const Layer& layer: seq.layers)
+		n = std::lcm(n, sequence_len(layer.seq));
+
+	return n;
+}
+
+// Steps a sequence holds in memory, its layers included.
+inline size_t sequence_stored(const Sequence& seq) {
+	size_t n = seq.size();
+
+	for (const Layer& layer: seq.layers)
+		n += sequence_stored(layer.seq);
+
+	return n;
+}
+
+// LCM of two lengths or nothing if it doesn't fit.
+inline std::optional<size_t> poly_len(size_t lhs, size_t rhs) {
+	if (lhs == 0 or rhs == 0)
+		return 0u;
+
+	size_t factor = lhs / std::gcd(lhs, rhs);
+
+	if (factor > std::numeric_limits<size_t>::max() / rhs)
+		return std::nullopt;
+
+	return factor * rhs;
+}
+
+// Step `i` of a sequence with layers, `i` must be less than its length.
+inline Event sequence_step(const Sequence& seq, size_t i) {
+	Event ev = i < seq.size() ? seq[i] : seq[i % seq.size()];
+
+	for (const Layer& layer: seq.layers)
+		ev = layer_combine(layer.op, ev, sequence_step(layer.seq, i));
+
+	return ev;
+}
+
+inline Sequence sequence_poly(Sequence lhs, Sequence rhs, Symbols op) {
+	lhs.layers.push_back({ op, std::move(rhs) });
+	return lhs;
+}
+
+// Every step written out, for operators that work on steps.
+inline Sequence sequence_expand(Sequence seq) {
+	if (seq.layers.empty())
+		return seq;
+
+	Sequence out;
+	out.bpm = seq.bpm;
+
+	size_t n = sequence_len(seq);
+	out.reserve(n);
+
+	for (size_t i = 0; i != n; ++i)
+		out.push_back(sequence_step(seq, i));
+
+	return out;
+}
+
 inline decltype(auto) sequence_car(Sequence seq) {
 	auto it = seq.begin();
 
@@ -125,20 +261,28 @@ inline decltype(auto) sequence_cdr(Sequence seq) {
 	return seq;
 }
 
-inline decltype(auto) sequence_len(const Sequence& seq) {
-	return seq.size();
+// Counted a step at a time so that layers are never expanded.
+inline size_t sequence_count(const Sequence& seq, uint8_t kind) {
+	if (seq.layers.empty())
+		return std::count_if(seq.begin(), seq.end(), [&] (auto& x) {
+			return x.kind == kind;
+		});
+
+	size_t count = 0;
+	size_t n = sequence_len(seq);
+
+	for (size_t i = 0; i != n; ++i)
+		count += sequence_step(seq, i).kind == kind;
+
+	return count;
 }
 
 inline decltype(auto) sequence_beats(const Sequence& seq) {
-	return std::count_if(seq.begin(), seq.end(), [] (auto& x) {
-		return x.kind == BEAT;
-	});
+	return sequence_count(seq, BEAT);
 }
 
 inline decltype(auto) sequence_skips(const Sequence& seq) {
-	return std::count_if(seq.begin(), seq.end(), [] (auto& x) {
-		return x.kind == SKIP;
-	});
+	return sequence_count(seq, SKIP);
 }
 
 }
@@ -0,0 +1,153 @@
+#ifndef CANE_PARALLEL_HPP
+#define CANE_PARALLEL_HPP
+
+namespace cane {
+
+// Data parallelism.
+// Kernels over very large sequences are split into chunks small enough to
+// stay in cache and handed out to a pool of workers shared by everything
+// in the process. The caller works on its own chunks too and only returns
+// once every chunk is done, so kernels can write straight into disjoint
+// ranges of memory allocated up front. Anything short of `PARALLEL_MIN`
+// isn't worth waking a thread for and runs in place.
+//
+// Workers are started on first use by whichever thread that was, usually
+// the compiler thread. They go back to the default scheduling class on
+// every CPU rather than inheriting its `-C` policy, a pool of busy realtime
+// threads pinned to one core would starve everything else on it.
+
+constexpr size_t PARALLEL_CHUNK = 1u << 16;  // Elements per chunk.
+constexpr size_t PARALLEL_MIN   = 1u << 20;  // Fewest elements worth splitting up.
+
+struct ParallelJob {
+	void (*fn)(void*, size_t, size_t) = nullptr;
+	void* user = nullptr;
+
+	size_t n = 0;
+	size_t chunks = 0;
+
+	std::atomic<size_t> next = 0;  // Next chunk to claim.
+	size_t active = 0;             // Workers on this job, guarded by the pool.
+
+	// Work on chunks until there are none left to claim.
+	inline void run() {
+		for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < chunks;)
+			fn(user, i * PARALLEL_CHUNK, std::min(n, (i + 1) * PARALLEL_CHUNK));
+	}
+};
+
+struct ThreadPool {
+	std::mutex lock;
+	std::condition_variable cv;
+
+	std::vector<ParallelJob*> jobs;  // With chunks still to claim.
+	std::vector<std::thread> threads;
+
+	bool stop = false;
+
+	inline ThreadPool(size_t n) {
+		threads.reserve(n);
+
+		for (size_t i = 0; i != n; ++i)
+			threads.emplace_back([this] { work(); });
+	}
+
+	inline ~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> guard { lock };
+			stop = true;
+		}
+
+		cv.notify_all();
+
+		for (std::thread& t: threads)
+			t.join();
+	}
+
+	inline void work() {
+		if (trace_enabled())
+			trace_register_thread("worker"_sv);
+
+		// Nothing to be done if it's refused, lowering never needs
+		// privileges anyway.
+		static_cast<void>(thread_policy_reset());
+
+		std::unique_lock<std::mutex> guard { lock };
+
+		while (true) {
+			cv.wait(guard, [&] { return stop or not jobs.empty(); });
+
+			if (stop)
+				return;
+
+			ParallelJob* job = jobs.back();
+			job->active++;
+
+			guard.unlock();
+			job->run();
+			guard.lock();
+
+			// Everything is claimed so no one else needs to look at it.
+			if (auto it = std::find(jobs.begin(), jobs.end(), job); it != jobs.end())
+				jobs.erase(it);
+
+			job->active--;
+			cv.notify_all();
+		}
+	}
+
+	// Returns once every chunk of `job` has run. A worker can still hold
+	// `job` after its last chunk is claimed so the caller waits for them
+	// to let go as well before it goes out of scope.
+	inline void run(ParallelJob& job) {
+		{
+			std::lock_guard<std::mutex> guard { lock };
+			jobs.push_back(&job);
+		}
+
+		cv.notify_all();
+		job.run();
+
+		std::unique_lock<std::mutex> guard { lock };
+
+		if (auto it = std::find(jobs.begin(), jobs.end(), &job); it != jobs.end())
+			jobs.erase(it);
+
+		cv.wait(guard, [&] { return job.active == 0; });
+	}
+};
+
+inline ThreadPool& thread_pool() {
+	static ThreadPool pool { std::max(std::thread::hardware_concurrency(), 1u) - 1u };
+	return pool;
+}
+
+// Call `f(begin, end)` over chunks of `[0, n)`. Chunks run at the same time
+// so `f` must only touch its own range and it must not throw. Nothing is
+// called for an empty range.
+template <typename F>
+inline void parallel_for(size_t n, F&& f) {
+	if (n == 0)
+		return;
+
+	if (n < PARALLEL_MIN or std::thread::hardware_concurrency() < 2) {
+		f(size_t { 0 }, n);
+		return;
+	}
+
+	ParallelJob job;
+
+	job.fn = [] (void* user, size_t begin, size_t end) {
+		(*static_cast<std::remove_reference_t<F>*>(user))(begin, end);
+	};
+
+	job.user = &f;
+	job.n = n;
+	job.chunks = (n + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK;
+
+	thread_pool().run(job);
+}
+
+}
+
+#endif
@@ -0,0 +1,459 @@
+#ifndef CANE_PLAYER_HPP
+#define CANE_PLAYER_HPP
+
+namespace cane {
+
+// Player.
+// Everything that decides what is written when, independent of where it is
+// written to. An output backend calls `Player::process` once per period
+// with something that can write into that period's port buffers, see
+// `backend.hpp` for what a backend provides.
+
+// Per-cycle measurements taken by the process callback.
+struct PlayerStats {
+	Histogram callback;  // Execution time in ns.
+	Histogram events;    // Events written per cycle.
+
+	std::atomic<uint64_t> lost      = 0;
+	std::atomic<uint64_t> xruns     = 0;
+	std::atomic<uint64_t> underruns = 0;  // Periods with no bucket ready.
+
+	std::atomic<uint64_t> spilled   = 0;  // Events carried into a later cycle.
+	std::atomic<uint64_t> dropped   = 0;  // Events lost because the spill queue was full.
+	std::atomic<uint64_t> cancelled = 0;  // Note-ons whose note-off went out first.
+};
+
+// Where playback picks up after a seek. The process callback stores the
+// position then bumps `generation` to publish it to the render thread.
+struct Playhead {
+	std::atomic<uint64_t> generation = 0;
+	std::atomic<size_t> index = 0;  // First event to render.
+	std::atomic<uint64_t> frame = 0;
+};
+
+// Keeps the bucket ring topped up so the process callback never has to
+// search the timeline itself. The ring is filled before the thread starts.
+// Without a thread, `fill` has to be called between periods instead.
+struct RenderThread {
+	BucketRing& ring;
+	const Playhead& playhead;
+	TimelineView timeline;
+
+	const std::atomic<uint32_t>& buffer_size;
+	const std::atomic<uint32_t>& sample_rate;
+
+	ThreadPolicy policy;
+
+	const MidiEvent* it = nullptr;
+	uint64_t frame = 0;
+	uint64_t generation = 0;
+	bool exhausted = false;  // Final bucket has been published.
+
+	std::atomic<bool> stop = false;
+	std::thread thread;
+
+	inline RenderThread(
+		BucketRing& ring_,
+		const Playhead& playhead_,
+		TimelineView timeline_,
+		const std::atomic<uint32_t>& buffer_size_,
+		const std::atomic<uint32_t>& sample_rate_,
+		bool threaded = true,
+		ThreadPolicy policy_ = {}
+	):
+		ring(ring_), playhead(playhead_), timeline(timeline_),
+		buffer_size(buffer_size_), sample_rate(sample_rate_),
+		policy(std::move(policy_)), it(timeline_.begin())
+	{
+		fill();
+
+		if (threaded)
+			thread = std::thread { [this] { run(); } };
+	}
+
+	inline ~RenderThread() {
+		stop.store(true, std::memory_order_relaxed);
+
+		if (thread.joinable())
+			thread.join();
+	}
+
+	// Render until the ring is full or the timeline runs out, starting over
+	// from the playhead whenever the process callback has seeked.
+	inline void fill() {
+		if (uint64_t gen = playhead.generation.load(std::memory_order_acquire); gen != generation) {
+			generation = gen;
+			it = timeline.begin() + playhead.index.load(std::memory_order_relaxed);
+			frame = playhead.frame.load(std::memory_order_relaxed);
+			exhausted = false;
+		}
+
+		while (not exhausted) {
+			Bucket* b = ring.acquire();
+
+			if (b == nullptr)
+				return;
+
+			CANE_TRACE_SPAN("render"_sv);
+
+			bucket_fill(*b, timeline, it, frame, buffer_size, sample_rate);
+			b->generation = generation;
+			exhausted = b->final;
+
+			ring.publish();
+		}
+	}
+
+	inline void run() {
+		if (trace_enabled())
+			trace_register_thread("render"_sv);
+
+		if (not policy.empty() and not thread_policy_apply(policy))
+			general_warning(STR_THREAD_POLICY, "render"_sv);
+
+		while (not stop.load(std::memory_order_relaxed)) {
+			fill();
+			std::this_thread::sleep_for(frame_time(buffer_size, sample_rate) / 2);
+		}
+	}
+};
+
+// Transport state as reported by a backend.
+struct Transport {
+	bool rolling = true;
+	uint64_t frame = 0;
+};
+
+struct Player {
+	// Also read by the render thread.
+	std::atomic<uint32_t> sample_rate = 0;
+	std::atomic<uint32_t> buffer_size = 0;
+
+	BucketRing ring;
+	std::atomic<bool> done = false;  // Final bucket and spill queue are out.
+
+	PlayerStats stats;
+
+	// Only touched by the process callback.
+	TimelineView timeline;
+	TimelineIndex index;  // Only built when following transport.
+	bool follow = false;
+
+	SpillQueue spill;
+	NoteSet held;
+
+	// Notes whose note-off didn't fit when they were released. They are
+	// still held and retried at the start of every period until they go.
+	NoteSet unreleased;
+	bool releasing = false;
+
+	Playhead playhead;
+	uint64_t generation = 0;
+	uint64_t expected = 0;  // Frame the next period should start at.
+
+	// After a seek the callback renders periods itself until the
+	// render thread has caught up.
+	Bucket scratch;
+	const MidiEvent* cursor = nullptr;
+	bool local = false;
+
+	bool finished = false;  // Final bucket has been consumed.
+
+	// Looping playback replaces the timeline entirely.
+	LoopEngine looper;
+	bool looping = false;
+	std::atomic<bool> stopping = false;
+
+	ThreadPolicy render_policy;  // Applied by the render thread to itself.
+
+	// Declared last so it stops before anything it reads goes away.
+	std::optional<RenderThread> renderer;
+
+	// Very important that the ring is filled before the backend starts
+	// calling `process` or else the first few periods will go out empty.
+	inline void play(TimelineView timeline_, bool threaded = true) {
+		timeline = timeline_;
+		renderer.emplace(ring, playhead, timeline, buffer_size, sample_rate, threaded, render_policy);
+	}
+
+	inline void loop(std::vector<Loop> loops, uint64_t bpm) {
+		looper = LoopEngine { std::move(loops), bpm };
+		looping = true;
+	}
+
+	// Seeking needs an index over the timeline.
+	inline void follow_transport(TimelineView timeline_) {
+		if (not looping)
+			index = timeline_index(timeline_);
+
+		follow = true;
+	}
+
+	// Lock everything `process` reads into memory, call once playback is
+	// set up and before the backend starts. Returns false if any of it
+	// could not be locked.
+	inline bool lock_memory() {
+		bool ok = memory_lock(this, sizeof(Player));
+
+		ok = memory_lock(timeline) and ok;
+		ok = memory_lock(index.checkpoints) and ok;
+
+		ok = memory_lock(looper.loops) and ok;
+		ok = memory_lock(looper.cursors) and ok;
+		ok = memory_lock(looper.pending) and ok;
+
+		for (const Loop& loop: looper.loops)
+			ok = memory_lock(loop.seq) and ok;
+
+		return ok;
+	}
+
+	// Release held notes and finish at the end of the next period.
+	inline void stop() {
+		stopping.store(true);
+	}
+
+	// Write everything due in the next `nframes` frames to `out`. Its port
+	// buffers are expected to have been cleared already.
+	template <typename Period>
+	inline void process(Period& out, uint32_t nframes) {
+		CANE_TRACE_SPAN("process"_sv);
+		auto start = std::chrono::steady_clock::now();
+
+		// The timeline may be gone once playback is over.
+		if (done.load(std::memory_order_relaxed))
+			return;
+
+		size_t written = 0;
+		size_t nports = out.ports();
+
+		// Events are stored with their length on the wire so they are
+		// copied straight into the space reserved for them. Events for
+		// every port are only written once they fit in all of them so
+		// that none of them ever sees one twice.
+		auto write = [&] (const MidiEvent& ev, uint32_t offset) {
+			if (ev.port != PORT_ALL) {
+				uint8_t* dst = out.reserve(ev.port, offset, ev.size);
+
+				if (dst == nullptr)
+					return false;
+
+				std::copy_n(ev.data.begin(), ev.size, dst);
+			}
+
+			else {
+				for (size_t i = 0; i != nports; ++i) {
+					if (out.room(i) < ev.size)
+						return false;
+				}
+
+				for (size_t i = 0; i != nports; ++i) {
+					if (uint8_t* dst = out.reserve(i, offset, ev.size))
+						std::copy_n(ev.data.begin(), ev.size, dst);
+				}
+			}
+
+			held.apply(ev);
+
+			if (releasing)
+				unreleased.forget(ev);
+
+			written++;
+
+			return true;
+		};
+
+		// Note-offs for everything still sounding. A note only stops being
+		// held once its note-off is written, those that don't fit are
+		// retried next period.
+		auto release = [&] {
+			held.each([&] (uint8_t port, uint8_t chan, uint8_t note) {
+				if (write({ 0, static_cast<uint8_t>(midi2int(Midi::NOTE_OFF) | chan), note, VELOCITY_DEFAULT, port }, 0))
+					return;
+
+				unreleased.insert(port, chan, note);
+				releasing = true;
+			});
+		};
+
+		if (releasing) {
+			unreleased.each([&] (uint8_t port, uint8_t chan, uint8_t note) {
+				write({ 0, static_cast<uint8_t>(midi2int(Midi::NOTE_OFF) | chan), note, VELOCITY_DEFAULT, port }, 0);
+			});
+
+			releasing = unreleased.any();
+		}
+
+		// Jump to `frame`, silencing the old position and bringing back
+		// any notes that should be held at the new one. The render thread
+		// restarts from here and we render locally until it catches up.
+		auto seek = [&] (uint64_t frame) {
+			CANE_TRACE_SPAN("seek"_sv);
+
+			Seek found = timeline_seek(timeline, index, frame, sample_rate);
+
+			release();
+			spill.clear();
+
+			found.held.each([&] (uint8_t port, uint8_t chan, uint8_t note) {
+				write({ 0, static_cast<uint8_t>(midi2int(Midi::NOTE_ON) | chan), note, VELOCITY_DEFAULT, port }, 0);
+			});
+
+			cursor = found.it;
+			local = true;
+			finished = false;
+
+			playhead.index.store(found.it - timeline.begin(), std::memory_order_relaxed);
+			playhead.frame.store(frame, std::memory_order_relaxed);
+			playhead.generation.store(++generation, std::memory_order_release);
+		};
+
+		// Ports whose buffer is full this period.
+		std::array<bool, PORT_MAX> full {};
+
+		// Copy a period's events into the port buffers in a single pass.
+		// Events are written relative to `position` so a bucket rendered
+		// for an earlier period goes out at the start of this one. Once a
+		// port's buffer is full, the rest of its events are carried over
+		// to the next cycle.
+		auto play = [&] (const Bucket& b, uint64_t position) {
+			size_t i = 0;
+
+			for (const MidiEvent* it = b.first; it != b.last; ++it, ++i) {
+				if (not spill.deferred.empty() and is_note_off(*it))
+					stats.cancelled.fetch_add(spill.cancel(*it), std::memory_order_relaxed);
+
+				bool fits = it->port != PORT_ALL ?
+					not full[it->port] :
+					std::none_of(full.begin(), full.begin() + nports, [] (bool x) { return x; });
+
+				// Offsets only overrun if the buffer size shrank after rendering.
+				uint64_t at = b.frame + b.offset(i);
+				uint32_t offset = at > position ? std::min<uint64_t>(at - position, nframes - 1) : 0u;
+
+				if (fits and write(*it, offset))
+					continue;
+
+				if (it->port != PORT_ALL)
+					full[it->port] = true;
+
+				else
+					full.fill(true);
+
+				if (spill.push(it))
+					stats.spilled.fetch_add(1, std::memory_order_relaxed);
+
+				else
+					stats.dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			finished = b.final;
+		};
+
+		uint64_t position = expected;
+		bool rolling = true;
+
+		if (follow) {
+			Transport transport = out.transport();
+			rolling = transport.rolling;
+			position = transport.frame;
+		}
+
+		if (looping) {
+			if (stopping.load(std::memory_order_relaxed)) {
+				release();
+				finished = true;
+			}
+
+			else if (not rolling)
+				release();
+
+			// Loops work out where they are from the frame alone so
+			// relocating is just a matter of recomputing cursors.
+			else {
+				if (position != expected) {
+					release();
+					looper.seek(position, sample_rate);
+				}
+
+				size_t dropped = looper.process(position, nframes, sample_rate, write);
+				stats.dropped.fetch_add(dropped, std::memory_order_relaxed);
+
+				expected = position + nframes;
+			}
+		}
+
+		else if (not rolling)
+			release();
+
+		else {
+			if (follow and position != expected)
+				seek(position);
+
+			// Events left over from previous cycles go out first.
+			bool room = spill.flush([&] (const MidiEvent& ev) {
+				return write(ev, 0);
+			});
+
+			full.fill(not room);
+
+			// Skip buckets from before the last seek and any periods that
+			// were already rendered locally.
+			const Bucket* b = nullptr;
+
+			while ((b = ring.peek()) and (b->generation != generation or (local and b->frame < position)))
+				ring.release();
+
+			// Out of step with transport, i.e. the buffer size changed.
+			if (follow and b != nullptr and b->frame != position) {
+				seek(position);
+				b = nullptr;
+			}
+
+			// Everything that starts before the end of this period. After
+			// an underrun the render thread is behind and its late buckets
+			// are played at once so that playback is back on time from the
+			// next bucket rather than a period late for the rest of the
+			// song. A bucket that starts later is left for its own period.
+			bool played = false;
+
+			for (; b != nullptr and b->frame < position + nframes; b = ring.peek()) {
+				local = false;
+				played = true;
+
+				play(*b, position);
+				ring.release();
+			}
+
+			if (not played and local) {
+				uint64_t frame = position;
+				bucket_fill(scratch, timeline, cursor, frame, nframes, sample_rate);
+				play(scratch, position);
+			}
+
+			else if (not played and b == nullptr and not finished)
+				stats.underruns.fetch_add(1, std::memory_order_relaxed);
+
+			expected = position + nframes;
+		}
+
+		if (finished and spill.empty() and not releasing)
+			done.store(true, std::memory_order_release);
+
+		CANE_TRACE_COUNTER("events written"_sv, written);
+
+		if (size_t lost = out.lost()) {
+			stats.lost.fetch_add(lost, std::memory_order_relaxed);
+			general_warning(STR_LOST_EVENT, lost);
+		}
+
+		stats.events.record(written);
+		stats.callback.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start
+		).count());
+	}
+};
+
+}
+
+#endif
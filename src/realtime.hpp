@@ -0,0 +1,138 @@
+#ifndef CANE_REALTIME_HPP
+#define CANE_REALTIME_HPP
+
+namespace cane {
+
+// Realtime hygiene.
+// The process callback must never wait on the kernel. Everything it reads
+// is locked into memory and touched once up front so that the first pass
+// over it can't page-fault mid-set. Helper threads can be kept off its
+// cores and the render thread is held below JACK's own priority.
+
+inline size_t page_size() {
+	static const size_t size = [] {
+		long n = sysconf(_SC_PAGESIZE);
+		return n > 0 ? static_cast<size_t>(n) : size_t { 4096 };
+	} ();
+
+	return size;
+}
+
+// Lock the pages spanning `[ptr, ptr + size)` and fault them in. Large
+// anonymous ranges are also offered to transparent huge pages which the
+// kernel ignores for file mappings. Returns false if the pages could not
+// be locked although they are still prefaulted.
+inline bool memory_lock(const void* ptr, size_t size) {
+	if (ptr == nullptr or size == 0)
+		return true;
+
+	uintptr_t page = page_size();
+	uintptr_t begin = reinterpret_cast<uintptr_t>(ptr) & ~(page - 1);
+	uintptr_t end = (reinterpret_cast<uintptr_t>(ptr) + size + page - 1) & ~(page - 1);
+
+	#ifdef MADV_HUGEPAGE
+		madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+	#endif
+
+	bool locked = mlock(reinterpret_cast<void*>(begin), end - begin) == 0;
+
+	for (uintptr_t p = begin; p < end; p += page)
+		static_cast<void>(*reinterpret_cast<const volatile uint8_t*>(p));
+
+	return locked;
+}
+
+// Everything allocated, not only what is in use, so that scratch space
+// which was only reserved is locked before it is first written to.
+template <typename T>
+inline bool memory_lock(const std::vector<T>& v) {
+	return memory_lock(v.data(), v.capacity() * sizeof(T));
+}
+
+template <typename T>
+inline bool memory_lock(ArrayView<T> v) {
+	return memory_lock(v.begin(), v.size() * sizeof(T));
+}
+
+inline bool memory_lock(TimelineView tl) {
+	bool ok = memory_lock(tl.begin(), tl.size() * sizeof(MidiEvent));
+
+	ok = memory_lock(tl.tempo) and ok;
+	ok = memory_lock(tl.ports) and ok;
+
+	return ok;
+}
+
+// Scheduling class, priority and CPU affinity for a helper thread. Nothing
+// is changed unless it was asked for.
+struct ThreadPolicy {
+	std::optional<int> policy;  // SCHED_*
+	int priority = 0;
+
+	std::vector<size_t> cpus;
+
+	inline bool empty() const {
+		return not policy and cpus.empty();
+	}
+};
+
+// Apply `p` to the calling thread. Returns false if the system refused,
+// usually for lack of privileges.
+inline bool thread_policy_apply(const ThreadPolicy& p) {
+	bool ok = true;
+
+	if (p.policy) {
+		sched_param param {};
+		param.sched_priority = p.priority;
+
+		ok = pthread_setschedparam(pthread_self(), *p.policy, &param) == 0 and ok;
+	}
+
+	if (not p.cpus.empty()) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+
+		for (size_t cpu: p.cpus)
+			if (cpu < CPU_SETSIZE)
+				CPU_SET(cpu, &set);
+
+		ok = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 and ok;
+	}
+
+	return ok;
+}
+
+// Lower a realtime priority to below `ceiling`, falling back to the default
+// class if there's no room under it. Returns true if `p` was changed.
+inline bool thread_policy_cap(ThreadPolicy& p, int ceiling) {
+	if (not p.policy or (*p.policy != SCHED_FIFO and *p.policy != SCHED_RR) or p.priority < ceiling)
+		return false;
+
+	p.priority = ceiling - 1;
+
+	if (p.priority < sched_get_priority_min(*p.policy)) {
+		p.policy = SCHED_OTHER;
+		p.priority = 0;
+	}
+
+	return true;
+}
+
+// Put the calling thread back to the default class on every CPU the
+// process may run on, whatever the thread that started it was using.
+inline bool thread_policy_reset() {
+	sched_param param {};
+	bool ok = pthread_setschedparam(pthread_self(), SCHED_OTHER, &param) == 0;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+
+	if (sched_getaffinity(getpid(), sizeof(set), &set) == 0)
+		ok = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 and ok;
+
+	return ok;
+}
+
+}
+
+#endif
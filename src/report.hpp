@@ -73,6 +73,19 @@ namespace cane {
 		return a_begin <= b_end and a_end >= b_begin;
 	}
 
+	// Line and column of `sv` within `src`, both starting at 1.
+	struct Location {
+		size_t line = 1;
+		size_t column = 1;
+	};
+
+	constexpr Location location(View src, View sv) {
+		return {
+			count_lines(encompass(src, sv)) + 1,
+			length(cane::before(extend_to_line(src, sv), sv)) + 1,
+		};
+	}
+
 	template <Reports R = Reports::ERROR>
 	inline std::ostream& report(
 		std::ostream& os,
@@ -89,8 +102,7 @@ namespace cane {
 		const auto before = cane::before(focused_line, sv);
 		const auto after = cane::after(focused_line, sv);
 
-		const auto column_n = length(before) + 1;
-		const auto line_n = count_lines(encompass(src, sv)) + 1;
+		const auto [line_n, column_n] = location(src, sv);
 
 		auto highlight = report2colour(R);
 
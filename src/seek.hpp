@@ -0,0 +1,137 @@
+#ifndef CANE_SEEK_HPP
+#define CANE_SEEK_HPP
+
+namespace cane {
+
+// Seeking.
+// Following JACK transport means playback can jump anywhere in the
+// timeline. Events are sorted by time so the first event due at a frame is
+// found by binary search. Which notes should already be sounding there is
+// rebuilt from sparse checkpoints of held notes taken every `SEEK_STRIDE`
+// events, so a seek touches at most that many events however long the
+// timeline is and is cheap enough to do from the process callback.
+
+constexpr size_t SEEK_STRIDE = 1u << 10;
+constexpr size_t NOTE_COUNT  = 128u;
+
+// Notes currently held down on each channel of every port.
+struct NoteSet {
+	std::array<std::bitset<NOTE_COUNT>, CHANNEL_MAX * PORT_MAX> channels {};
+
+	inline void apply(const MidiEvent& ev) {
+		uint8_t kind = ev.data[0] & 0xF0;
+		uint8_t chan = ev.data[0] & 0x0F;
+
+		if (ev.port == PORT_ALL) {
+			if (kind == midi2int(Midi::CHANNEL_MODE) and (ev.data[1] == ALL_NOTES_OFF or ev.data[1] == ALL_SOUND_OFF)) {
+				for (size_t port = 0; port != PORT_MAX; ++port)
+					channels[port * CHANNEL_MAX + chan].reset();
+			}
+
+			return;
+		}
+
+		auto& notes = channels[(ev.port % PORT_MAX) * CHANNEL_MAX + chan];
+
+		if (is_note_off(ev))
+			notes.reset(ev.data[1] % NOTE_COUNT);
+
+		else if (kind == midi2int(Midi::NOTE_ON))
+			notes.set(ev.data[1] % NOTE_COUNT);
+
+		else if (kind == midi2int(Midi::CHANNEL_MODE) and (ev.data[1] == ALL_NOTES_OFF or ev.data[1] == ALL_SOUND_OFF))
+			notes.reset();
+	}
+
+	inline void insert(uint8_t port, uint8_t chan, uint8_t note) {
+		channels[(port % PORT_MAX) * CHANNEL_MAX + chan].set(note % NOTE_COUNT);
+	}
+
+	// Drop whatever note `ev` turns on or off, so it's no longer waiting
+	// on a note-off of its own.
+	inline void forget(const MidiEvent& ev) {
+		uint8_t kind = ev.data[0] & 0xF0;
+
+		if (ev.port != PORT_ALL and (kind == midi2int(Midi::NOTE_ON) or kind == midi2int(Midi::NOTE_OFF)))
+			channels[(ev.port % PORT_MAX) * CHANNEL_MAX + (ev.data[0] & 0x0F)].reset(ev.data[1] % NOTE_COUNT);
+
+		else
+			apply(ev);
+	}
+
+	inline bool any() const {
+		return std::any_of(channels.begin(), channels.end(), [] (auto& notes) {
+			return notes.any();
+		});
+	}
+
+	inline void clear() {
+		for (auto& notes: channels)
+			notes.reset();
+	}
+
+	// Call `fn(port, channel, note)` for every held note.
+	template <typename F>
+	inline void each(F&& fn) const {
+		for (size_t i = 0; i != channels.size(); ++i) {
+			if (channels[i].none())
+				continue;
+
+			for (size_t note = 0; note != NOTE_COUNT; ++note) {
+				if (channels[i].test(note))
+					fn(static_cast<uint8_t>(i / CHANNEL_MAX), static_cast<uint8_t>(i % CHANNEL_MAX), static_cast<uint8_t>(note));
+			}
+		}
+	}
+};
+
+struct TimelineIndex {
+	std::vector<NoteSet> checkpoints;  // Notes held before event `i * SEEK_STRIDE`.
+};
+
+inline TimelineIndex timeline_index(TimelineView tl) {
+	CANE_LOG(LogLevel::INF);
+
+	TimelineIndex index {};
+	index.checkpoints.reserve(tl.size() / SEEK_STRIDE + 1);
+
+	NoteSet held {};
+
+	for (size_t i = 0; i != tl.size(); ++i) {
+		if (i % SEEK_STRIDE == 0)
+			index.checkpoints.push_back(held);
+
+		held.apply(tl.begin()[i]);
+	}
+
+	// Seeking to the very end needs a checkpoint too.
+	if (tl.size() % SEEK_STRIDE == 0)
+		index.checkpoints.push_back(held);
+
+	return index;
+}
+
+struct Seek {
+	const MidiEvent* it = nullptr;  // First event due at or after the frame.
+	NoteSet held {};                // Notes sounding just before it.
+};
+
+inline Seek timeline_seek(TimelineView tl, const TimelineIndex& index, uint64_t frame, uint64_t sample_rate) {
+	const MidiEvent* it = std::partition_point(tl.begin(), tl.end(), [&] (const MidiEvent& ev) {
+		return event_frame(ev.time, tl, sample_rate) < frame;
+	});
+
+	size_t i = it - tl.begin();
+	size_t checkpoint = i / SEEK_STRIDE;
+
+	Seek seek { it, index.checkpoints[checkpoint] };
+
+	for (const MidiEvent* ev = tl.begin() + checkpoint * SEEK_STRIDE; ev != it; ++ev)
+		seek.held.apply(*ev);
+
+	return seek;
+}
+
+}
+
+#endif
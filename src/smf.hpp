@@ -0,0 +1,242 @@
+#ifndef CANE_SMF_HPP
+#define CANE_SMF_HPP
+
+namespace cane {
+
+// Standard MIDI File writer.
+// A timeline is rendered as a type 1 file: a conductor track holding the
+// tempo and time signature followed by one track per MIDI channel of each
+// port. When there is more than one port, tracks say which one they belong
+// to with a port prefix. System real-time messages (clock, sensing,
+// start/stop) have no meaning in a file and are dropped.
+
+constexpr uint16_t SMF_FORMAT   = 1u;
+constexpr uint16_t SMF_PPQ      = 960u;
+constexpr uint32_t SMF_VLQ_MAX  = 0x0FFFFFFFu;
+constexpr uint64_t SMF_RAMP_DIV = 4u;  // Tempo changes per quarter note along a ramp.
+constexpr uint32_t SMF_TEMPO_MAX = 0xFFFFFFu;  // µs per quarter note, a tempo is 24 bits.
+
+constexpr uint8_t SMF_META          = 0xFF;
+constexpr uint8_t SMF_META_TEXT     = 0x01;
+constexpr uint8_t SMF_META_PORT     = 0x21;
+constexpr uint8_t SMF_META_EOT      = 0x2F;
+constexpr uint8_t SMF_META_TEMPO    = 0x51;
+constexpr uint8_t SMF_META_TIME_SIG = 0x58;
+
+constexpr bool is_channel_message(uint8_t status) {
+	return status >= 0x80 and status < 0xF0;
+}
+
+// Convert a point in time to ticks at `SMF_PPQ` resolution for a given tempo.
+constexpr uint64_t smf_ticks(Tick t, Rate rate, uint64_t bpm) {
+	uint64_t ticks = t < 0 ? 0u : t;
+	uint64_t per_min = SMF_PPQ * bpm;
+
+	return (ticks / rate) * per_min + ((ticks % rate) * per_min + rate / 2) / rate;
+}
+
+struct SmfTrack {
+	std::vector<uint8_t> data;
+
+	uint64_t tick = 0;
+	uint8_t status = 0;  // Running status, 0 when cancelled.
+
+	inline void u8(uint8_t x) {
+		data.push_back(x);
+	}
+
+	// Variable length quantity: 7 bits per byte, most significant group
+	// first with the high bit set on every byte except the last.
+	inline void vlq(uint32_t x) {
+		uint8_t tmp[4];
+		size_t n = 0;
+
+		do {
+			tmp[n++] = x & 0x7F;
+			x >>= 7;
+		} while (x != 0);
+
+		while (n--)
+			u8(tmp[n] | (n != 0 ? 0x80 : 0x00));
+	}
+
+	inline void delta(uint64_t at) {
+		uint64_t d = at > tick ? at - tick : 0;
+
+		// Deltas that don't fit in a VLQ are padded with empty text events.
+		// Meta events cancel running status.
+		while (d > SMF_VLQ_MAX) {
+			vlq(SMF_VLQ_MAX);
+			u8(SMF_META); u8(SMF_META_TEXT); u8(0);
+
+			status = 0;
+			d -= SMF_VLQ_MAX;
+		}
+
+		vlq(d);
+		tick = std::max(at, tick);
+	}
+
+	inline void meta(uint64_t at, uint8_t kind, std::initializer_list<uint8_t> bytes) {
+		delta(at);
+
+		u8(SMF_META);
+		u8(kind);
+		vlq(bytes.size());
+
+		data.insert(data.end(), bytes.begin(), bytes.end());
+		status = 0;
+	}
+
+	inline void event(uint64_t at, const MidiEvent& ev) {
+		delta(at);
+
+		auto [st, a, b] = ev.data;
+
+		// Running status: omit the status byte if it repeats.
+		if (st != status)
+			u8(st);
+
+		status = st;
+
+		u8(a);
+		if (midi_length(st) == 3u)
+			u8(b);
+	}
+};
+
+inline std::ostream& smf_chunk(std::ostream& os, const char* kind, const std::vector<uint8_t>& body) {
+	uint32_t n = body.size();
+
+	const char header[] = {
+		kind[0], kind[1], kind[2], kind[3],
+		static_cast<char>(n >> 24), static_cast<char>(n >> 16),
+		static_cast<char>(n >> 8),  static_cast<char>(n),
+	};
+
+	os.write(header, sizeof(header));
+	return os.write(reinterpret_cast<const char*>(body.data()), body.size());
+}
+
+inline std::ostream& render_smf(std::ostream& os, const Timeline& tl) {
+	CANE_LOG(LogLevel::WRN);
+
+	uint64_t end = smf_ticks(tl.duration, tl.rate, tl.bpm);
+
+	// Conductor track.
+	SmfTrack conductor;
+
+	// Tempos slower than a file can hold are written as the slowest it can.
+	size_t clamped = 0;
+
+	auto set_tempo = [&] (Tick at, uint64_t tempo) {  // µs per quarter note
+		if (tempo > SMF_TEMPO_MAX) {
+			tempo = SMF_TEMPO_MAX;
+			clamped++;
+		}
+
+		conductor.meta(smf_ticks(at, tl.rate, tl.bpm), SMF_META_TEMPO, {
+			static_cast<uint8_t>(tempo >> 16),
+			static_cast<uint8_t>(tempo >> 8),
+			static_cast<uint8_t>(tempo),
+		});
+	};
+
+	std::vector<std::pair<Tick, uint64_t>> changes;
+
+	if (tl.tempo.empty())
+		changes.emplace_back(0, ONE_MIN.count() / tl.bpm);
+
+	// Files can't ramp so ramps become a staircase. Each stair takes the
+	// average tempo across it so the real time at every stair is exact.
+	TimelineView view { tl };
+	Tick stair = std::max<Rate>(tl.rate / (tl.bpm * SMF_RAMP_DIV), 1u);
+
+	auto average = [&] (Tick from, Tick to) {
+		double seconds = (timeline_seconds(view, to) - timeline_seconds(view, from)).count();
+		double quarters = static_cast<double>(to - from) * tl.bpm / tl.rate;
+
+		return static_cast<uint64_t>(std::llround(std::min(seconds * 1e6 / quarters, 1e18)));
+	};
+
+	for (auto it = tl.tempo.begin(); it != tl.tempo.end(); ++it) {
+		// Only a point followed by another can ramp.
+		if (it->slope == 0.0) {
+			changes.emplace_back(it->time, average(it->time, it->time + 1));
+			continue;
+		}
+
+		Tick until = std::next(it)->time;
+
+		for (Tick at = it->time; at < until; at += stair)
+			changes.emplace_back(at, average(at, std::min(at + stair, until)));
+	}
+
+	set_tempo(changes.front().first, changes.front().second);
+	conductor.meta(0, SMF_META_TIME_SIG, { 4, 2, 24, 8 });  // 4/4
+
+	for (auto it = std::next(changes.begin()); it != changes.end(); ++it)
+		set_tempo(it->first, it->second);
+
+	conductor.meta(end, SMF_META_EOT, {});
+
+	if (clamped != 0)
+		general_warning(STR_SMF_TEMPO, clamped, static_cast<double>(ONE_MIN.count()) / SMF_TEMPO_MAX);
+
+	// Split channel messages into their own tracks. The timeline is already
+	// sorted so each track receives its events in order.
+	std::vector<SmfTrack> channels(CHANNEL_MAX * PORT_MAX);
+	std::bitset<CHANNEL_MAX * PORT_MAX> used;
+
+	size_t nports = std::clamp<size_t>(tl.ports.size(), 1u, PORT_MAX);
+
+	for (const MidiEvent& ev: tl) {
+		uint8_t status = ev.data[0];
+
+		if (not is_channel_message(status))
+			continue;
+
+		uint8_t chan = status & 0x0F;
+
+		size_t from = ev.port == PORT_ALL ? 0u : ev.port % PORT_MAX;
+		size_t to = ev.port == PORT_ALL ? nports : from + 1u;
+
+		for (size_t port = from; port != to; ++port) {
+			size_t i = port * CHANNEL_MAX + chan;
+
+			if (not used.test(i) and nports > 1)
+				channels[i].meta(0, SMF_META_PORT, { static_cast<uint8_t>(port) });
+
+			channels[i].event(smf_ticks(ev.time, tl.rate, tl.bpm), ev);
+			used.set(i);
+		}
+	}
+
+	uint16_t ntracks = 1;
+	for (size_t i = 0; i != channels.size(); ++i) {
+		if (used.test(i)) {
+			channels[i].meta(end, SMF_META_EOT, {});
+			ntracks++;
+		}
+	}
+
+	const std::vector<uint8_t> header = {
+		SMF_FORMAT >> 8, SMF_FORMAT & 0xFF,
+		static_cast<uint8_t>(ntracks >> 8), static_cast<uint8_t>(ntracks),
+		SMF_PPQ >> 8, SMF_PPQ & 0xFF,
+	};
+
+	smf_chunk(os, "MThd", header);
+	smf_chunk(os, "MTrk", conductor.data);
+
+	for (size_t i = 0; i != channels.size(); ++i) {
+		if (used.test(i))
+			smf_chunk(os, "MTrk", channels[i].data);
+	}
+
+	return os;
+}
+
+}
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef CANE_SPILL_HPP
+#define CANE_SPILL_HPP
+
+namespace cane {
+
+// Spill queue.
+// Events which don't fit in a JACK port buffer are carried over into the
+// next cycle instead of being lost. Everything is fixed size and only ever
+// touched by the process thread so it is safe to use in realtime context.
+// Note-offs, clock and other messages are flushed before any deferred
+// note-ons so that a dense burst can delay notes but never leave them stuck.
+
+constexpr size_t SPILL_CAPACITY = 1u << 12;  // Events per priority.
+
+enum class SpillPriority: uint8_t {
+	URGENT,    // Note-offs, clock, channel mode etc.
+	DEFERRED,  // Note-ons.
+};
+
+constexpr bool is_note_off(const MidiEvent& ev) {
+	uint8_t kind = ev.data[0] & 0xF0;
+
+	return
+		kind == midi2int(Midi::NOTE_OFF) or
+		(kind == midi2int(Midi::NOTE_ON) and ev.data[2] == 0);
+}
+
+constexpr SpillPriority spill_priority(const MidiEvent& ev) {
+	bool note_on =
+		(ev.data[0] & 0xF0) == midi2int(Midi::NOTE_ON) and
+		ev.data[2] != 0;  // Note-on with zero velocity is a note-off.
+
+	return note_on ? SpillPriority::DEFERRED : SpillPriority::URGENT;
+}
+
+// Events are stored by pointer since the timeline outlives playback.
+struct SpillRing {
+	std::array<const MidiEvent*, SPILL_CAPACITY> events {};
+
+	size_t head = 0;
+	size_t size = 0;
+
+	constexpr bool empty() const { return size == 0; }
+	constexpr bool full() const { return size == SPILL_CAPACITY; }
+
+	constexpr const MidiEvent*& at(size_t i) {
+		return events[(head + i) % SPILL_CAPACITY];
+	}
+
+	constexpr bool push(const MidiEvent* ev) {
+		if (full())
+			return false;
+
+		at(size++) = ev;
+		return true;
+	}
+
+	constexpr void clear() {
+		head = 0;
+		size = 0;
+	}
+
+	constexpr const MidiEvent* front() {
+		return at(0);
+	}
+
+	constexpr void pop() {
+		head = (head + 1) % SPILL_CAPACITY;
+		size--;
+	}
+};
+
+struct SpillQueue {
+	SpillRing urgent;
+	SpillRing deferred;
+
+	constexpr bool empty() const {
+		return urgent.empty() and deferred.empty();
+	}
+
+	constexpr void clear() {
+		urgent.clear();
+		deferred.clear();
+	}
+
+	// A note-off that overtakes its note-on would leave the note hanging,
+	// so any matching note-on still waiting is discarded instead. Returns
+	// the number of note-ons discarded.
+	constexpr size_t cancel(const MidiEvent& off) {
+		uint8_t channel = off.data[0] & 0x0F;
+		uint8_t note = off.data[1];
+
+		size_t cancelled = 0;
+
+		for (size_t i = 0; i != deferred.size; ++i) {
+			const MidiEvent*& ev = deferred.at(i);
+
+			if (ev != nullptr and ev->port == off.port and (ev->data[0] & 0x0F) == channel and ev->data[1] == note) {
+				ev = nullptr;
+				cancelled++;
+			}
+		}
+
+		return cancelled;
+	}
+
+	// Returns false if the event had to be dropped because the queue is full.
+	constexpr bool push(const MidiEvent* ev) {
+		SpillRing& ring = spill_priority(*ev) == SpillPriority::URGENT ? urgent : deferred;
+		return ring.push(ev);
+	}
+
+	// Write as much of the queue as fits, highest priority first. Returns
+	// false once the buffer is full.
+	template <typename F>
+	constexpr bool flush(F&& write) {
+		for (SpillRing* ring: { &urgent, &deferred }) {
+			while (not ring->empty()) {
+				const MidiEvent* ev = ring->front();
+
+				if (ev != nullptr and not write(*ev))
+					return false;
+
+				ring->pop();
+			}
+		}
+
+		return true;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,847 @@
+#ifndef CANE_STATIC_HPP
+#define CANE_STATIC_HPP
+
+namespace cane {
+
+// Static compilation.
+// Compiles a pattern given as a string literal entirely in a constant
+// expression, leaving a fixed-size array of events in the binary. Nothing
+// is parsed and nothing is allocated at runtime which suits hosts without
+// a heap. The result is the same timeline `compile` would produce, the
+// bench checks the two against each other before it runs:
+//
+//     constexpr auto tl = CANE_STATIC("bpm 120 note 60 send 1 !..! map 69");
+//     player.play(tl.view());
+//
+// Storage is fixed so sequences and symbol tables are bounded by the limits
+// below. Tempo changes are not supported since the tempo map needs floating
+// point functions that aren't constexpr and `?` is accepted but prints
+// nothing. Literals are checked as `compile` checks them and sends are held
+// to the default `Budget`. Errors are thrown as `StaticError` which fails
+// the constant expression so the compiler reports where. Long patterns may need a larger
+// `-fconstexpr-ops-limit` (GCC) or `-fconstexpr-steps` (Clang).
+
+constexpr size_t STATIC_STEPS_MAX   = 256u;  // Steps in any one sequence.
+constexpr size_t STATIC_SYMBOLS_MAX = 64u;   // Constants, aliases and chains each.
+
+// Same message as the runtime compiler would report, unformatted.
+struct StaticError {
+	Phases phase;
+	View sv;
+	View what;
+};
+
+struct StaticSequence {
+	std::array<Event, STATIC_STEPS_MAX> steps {};
+	size_t size = 0;
+	uint64_t bpm = BPM_DEFAULT;
+
+	constexpr bool push(Event ev) {
+		if (size == steps.size())
+			return false;
+
+		steps[size++] = ev;
+		return true;
+	}
+
+	constexpr Event* begin() { return steps.data(); }
+	constexpr Event* end() { return steps.data() + size; }
+
+	constexpr const Event* begin() const { return steps.data(); }
+	constexpr const Event* end() const { return steps.data() + size; }
+};
+
+// Linear lookup, tables are small.
+template <typename T>
+struct StaticTable {
+	std::array<View, STATIC_SYMBOLS_MAX> keys {};
+	std::array<T, STATIC_SYMBOLS_MAX> values {};
+	size_t size = 0;
+
+	constexpr const T* find(View key) const {
+		for (size_t i = 0; i != size; ++i) {
+			if (keys[i] == key)
+				return &values[i];
+		}
+
+		return nullptr;
+	}
+
+	constexpr bool emplace(View key, const T& value) {
+		if (size == keys.size())
+			return false;
+
+		keys[size] = key;
+		values[size] = value;
+		size++;
+
+		return true;
+	}
+};
+
+// Symbol tables, lexer and compiler state in one. Events themselves go to
+// an output that either counts or stores them so the same compiler can size
+// the array and then fill it.
+struct StaticContext {
+	View original {};
+	View src {};
+
+	Token peek {};
+	Token prev {};
+
+	StaticTable<double> constants;
+	StaticTable<Channel> channels;
+	StaticTable<StaticSequence> chains;
+
+	std::array<PortName, PORT_MAX> ports {};
+	size_t nports = 0;
+
+	Tick time = 0;
+	Tick duration = 0;
+	Rate rate = timeline_rate(BPM_DEFAULT);
+	uint8_t port = PORT_DEFAULT;
+
+	uint64_t global_bpm = 0;
+	uint64_t global_note = 0;
+
+	constexpr StaticContext(View src_):
+		original(src_), src(src_) {}
+
+	constexpr void expect(bool ok, Phases phase, View sv, View what) const {
+		if (not ok)
+			throw StaticError { phase, sv, what };
+	}
+
+	constexpr Token next() {
+		Token tok = lex_token(src);
+		expect(tok.kind != Symbols::NONE, Phases::LEXICAL, tok.view, STR_UNKNOWN_CHAR);
+
+		Token out = peek;
+
+		prev = peek;
+		peek = tok;
+
+		return out;
+	}
+
+	constexpr bool defined(View sv) const {
+		return constants.find(sv) or channels.find(sv) or chains.find(sv);
+	}
+
+	// Declare a symbol, all kinds share one namespace.
+	template <typename T>
+	constexpr void define(StaticTable<T>& table, View sv, const T& value) {
+		expect(not defined(sv), Phases::SEMANTIC, sv, STR_CONFLICT);
+		expect(table.emplace(sv, value), Phases::SEMANTIC, sv, STR_STATIC_LIMIT);
+	}
+};
+
+// Only counts events, used to size the array.
+struct StaticCounter {
+	size_t count = 0;
+
+	constexpr void push(const MidiEvent&) {
+		count++;
+	}
+
+	constexpr void scale(Tick) {}
+};
+
+template <size_t N>
+struct StaticBuffer {
+	std::array<MidiEvent, N>& events;
+	size_t first = 0;
+	size_t count = 0;
+
+	constexpr void push(const MidiEvent& ev) {
+		events[first + count++] = ev;
+	}
+
+	constexpr void scale(Tick factor) {
+		for (size_t i = first; i != first + count; ++i)
+			events[i].time *= factor;
+	}
+};
+
+// Expressions
+[[nodiscard]] constexpr double static_literal_expr(StaticContext&, size_t);
+[[nodiscard]] constexpr StaticSequence static_sequence_expr(StaticContext&, size_t);
+
+constexpr double static_literal(StaticContext& ctx) {
+	ctx.expect(is_literal(ctx.peek), Phases::SYNTACTIC, ctx.peek.view, STR_LITERAL);
+	return b10_decode(ctx.next().view);
+}
+
+// Same checks as `literal_natural` and `literal_bpm`.
+constexpr uint64_t static_natural(StaticContext& ctx, View sv, double lit) {
+	ctx.expect(natural_fits(lit), Phases::SEMANTIC, sv, STR_BETWEEN);
+	return lit;
+}
+
+constexpr uint64_t static_natural_expr(StaticContext& ctx) {
+	View lit_v = ctx.peek.view;
+	double lit = static_literal_expr(ctx, 0);
+
+	return static_natural(ctx, encompass(lit_v, ctx.prev.view), lit);
+}
+
+constexpr uint64_t static_bpm(StaticContext& ctx, View sv, double lit) {
+	ctx.expect(bpm_fits(lit), Phases::SEMANTIC, sv, STR_BETWEEN);
+	return lit;
+}
+
+constexpr StaticSequence static_sequence(StaticContext& ctx, StaticSequence seq) {
+	ctx.expect(is_step(ctx.peek), Phases::SYNTACTIC, ctx.peek.view, STR_STEP);
+
+	while (is_step(ctx.peek)) {
+		Token tok = ctx.next();
+		ctx.expect(seq.push(Event { static_cast<uint8_t>(sym2step(tok.kind)) }), Phases::SEMANTIC, tok.view, STR_STATIC_LIMIT);
+	}
+
+	return seq;
+}
+
+constexpr StaticSequence static_euclide(StaticContext& ctx, View expr_v, StaticSequence seq) {
+	uint64_t steps = 0;
+	uint64_t beats = 0;
+
+	if (ctx.peek.kind == Symbols::SEP) {
+		ctx.next();  // skip `:`
+		beats = static_natural_expr(ctx);
+	}
+
+	else {
+		View beats_v = ctx.peek.view;
+		beats = static_natural(ctx, beats_v, static_literal(ctx));
+	}
+
+	ctx.expect(ctx.peek.kind == Symbols::SEP, Phases::SYNTACTIC, ctx.peek.view, STR_EXPECT);
+	ctx.next();  // skip `:`
+
+	steps = static_natural_expr(ctx);
+
+	ctx.expect(beats <= steps, Phases::SEMANTIC, encompass(expr_v, ctx.prev.view), STR_LESSER_EQ);
+	ctx.expect(steps <= STATIC_STEPS_MAX, Phases::SEMANTIC, encompass(expr_v, ctx.prev.view), STR_STATIC_LIMIT);
+
+	for (size_t i = 0; i != static_cast<size_t>(steps); ++i)
+		ctx.expect(seq.push(euclid_step(i, beats, steps)), Phases::SEMANTIC, encompass(expr_v, ctx.prev.view), STR_STATIC_LIMIT);
+
+	ctx.expect(seq.size != 0, Phases::SEMANTIC, encompass(expr_v, ctx.prev.view), STR_EMPTY);
+
+	return seq;
+}
+
+constexpr double static_literal_primary(StaticContext& ctx) {
+	Token tok = ctx.peek;
+
+	switch (tok.kind) {
+		case Symbols::INT: return static_literal(ctx);
+
+		case Symbols::IDENT: {
+			ctx.next();
+
+			const double* lit = ctx.constants.find(tok.view);
+			ctx.expect(lit != nullptr, Phases::SEMANTIC, tok.view, STR_UNDEFINED);
+
+			return *lit;
+		}
+
+		case Symbols::GLOBAL_BPM: {
+			ctx.next();  // skip `bpm`
+			return ctx.global_bpm;
+		}
+
+		case Symbols::GLOBAL_NOTE: {
+			ctx.next();  // skip `note`
+			return ctx.global_note;
+		}
+
+		case Symbols::LPAREN: {
+			ctx.next();  // skip `(`
+
+			double lit = static_literal_expr(ctx, 0);  // Reset binding power.
+
+			ctx.expect(ctx.peek.kind == Symbols::RPAREN, Phases::SYNTACTIC, ctx.peek.view, STR_EXPECT);
+			ctx.next();  // skip `)`
+
+			return lit;
+		}
+
+		default: break;
+	}
+
+	ctx.expect(false, Phases::SYNTACTIC, tok.view, STR_LIT_PRIMARY);
+	return 0;
+}
+
+constexpr double static_literal_expr(StaticContext& ctx, size_t bp) {
+	double lit = 0;
+	Token tok = ctx.peek;
+
+	if (is_literal_prefix(tok)) {
+		auto [lbp, rbp] = binding_power(tok.kind, OpFix::LIT_PREFIX);
+		ctx.next();
+
+		StaticSequence seq = static_sequence_expr(ctx, rbp);
+		size_t n = 0;
+
+		for (const Event& ev: seq) {
+			switch (tok.kind) {
+				case Symbols::LEN_OF:  { n++; } break;
+				case Symbols::BEAT_OF: { n += ev.kind == BEAT; } break;
+				case Symbols::SKIP_OF: { n += ev.kind == SKIP; } break;
+				default: break;
+			}
+		}
+
+		lit = n;
+	}
+
+	else
+		lit = static_literal_primary(ctx);
+
+	tok = ctx.peek;
+
+	while (is_literal_infix(tok)) {
+		auto [lbp, rbp] = binding_power(tok.kind, OpFix::LIT_INFIX);
+
+		if (lbp < bp)
+			break;
+
+		ctx.next();  // skip operator
+		double rhs = static_literal_expr(ctx, rbp);
+
+		switch (tok.kind) {
+			case Symbols::ADD: { lit = lit + rhs; } break;
+			case Symbols::SUB: { lit = lit - rhs; } break;
+			case Symbols::MUL: { lit = lit * rhs; } break;
+			case Symbols::DIV: { lit = lit / rhs; } break;
+			default: break;
+		}
+
+		tok = ctx.peek;
+	}
+
+	return lit;
+}
+
+constexpr StaticSequence static_sequence_primary(StaticContext& ctx, StaticSequence seq) {
+	Token tok = ctx.peek;
+
+	switch (tok.kind) {
+		case Symbols::INT:
+		case Symbols::SEP: return static_euclide(ctx, tok.view, seq);
+
+		case Symbols::SKIP:
+		case Symbols::BEAT: return static_sequence(ctx, seq);
+
+		case Symbols::IDENT: {
+			ctx.next();
+
+			const StaticSequence* chain = ctx.chains.find(tok.view);
+			ctx.expect(chain != nullptr, Phases::SEMANTIC, tok.view, STR_UNDEFINED);
+
+			return *chain;
+		}
+
+		case Symbols::LPAREN: {
+			ctx.next();  // skip `(`
+
+			seq = static_sequence_expr(ctx, 0);  // Reset binding power.
+
+			ctx.expect(ctx.peek.kind == Symbols::RPAREN, Phases::SYNTACTIC, ctx.peek.view, STR_EXPECT);
+			ctx.next();  // skip `)`
+
+			return seq;
+		}
+
+		default: break;
+	}
+
+	ctx.expect(false, Phases::SYNTACTIC, tok.view, STR_SEQ_PRIMARY);
+	return seq;
+}
+
+// Mirrors the operators in `ops.hpp`.
+constexpr StaticSequence static_sequence_infix(StaticContext& ctx, StaticSequence seq, size_t bp) {
+	Token tok = ctx.next();  // skip operator.
+
+	switch (tok.kind) {
+		case Symbols::CAT: {
+			StaticSequence rhs = static_sequence_expr(ctx, bp);
+
+			for (const Event& ev: rhs)
+				ctx.expect(seq.push(ev), Phases::SEMANTIC, tok.view, STR_STATIC_LIMIT);
+		} break;
+
+		// Only as many steps as both have, like `sequence_or` and friends.
+		case Symbols::OR:
+		case Symbols::AND:
+		case Symbols::XOR: {
+			StaticSequence rhs = static_sequence_expr(ctx, bp);
+
+			for (size_t i = 0; i != std::min(seq.size, rhs.size); ++i) {
+				Event& lhs = seq.steps[i];
+
+				if      (tok.kind == Symbols::OR)  lhs = rhs.steps[i] | lhs;
+				else if (tok.kind == Symbols::AND) lhs = rhs.steps[i] & lhs;
+				else                               lhs = rhs.steps[i] ^ lhs;
+			}
+		} break;
+
+		// Expanded straight away rather than layered, there's no sequence
+		// here long enough for it to matter.
+		case Symbols::POLY_OR:
+		case Symbols::POLY_AND:
+		case Symbols::POLY_XOR: {
+			View before_v = ctx.peek.view;
+			StaticSequence rhs = static_sequence_expr(ctx, bp);
+
+			size_t n = 0;
+
+			if (seq.size != 0 and rhs.size != 0)
+				n = seq.size / std::gcd(seq.size, rhs.size) * rhs.size;
+
+			ctx.expect(n <= STATIC_STEPS_MAX, Phases::SEMANTIC, encompass(before_v, ctx.prev.view), STR_STATIC_LIMIT);
+
+			StaticSequence out {};
+			out.bpm = seq.bpm;
+
+			for (size_t i = 0; i != n; ++i)
+				out.push(layer_combine(tok.kind, seq.steps[i % seq.size], rhs.steps[i % rhs.size]));
+
+			seq = out;
+		} break;
+
+		case Symbols::ROTL:
+		case Symbols::ROTR: {
+			size_t n = static_natural_expr(ctx) % seq.size;
+
+			if (tok.kind == Symbols::ROTR)
+				n = (seq.size - n) % seq.size;
+
+			StaticSequence out = seq;
+
+			for (size_t i = 0; i != seq.size; ++i)
+				out.steps[i] = seq.steps[(i + n) % seq.size];
+
+			seq = out;
+		} break;
+
+		case Symbols::REP: {
+			View before_v = ctx.peek.view;
+			uint64_t reps = static_natural_expr(ctx);
+
+			// We don't want to shrink the sequence, it can only grow.
+			ctx.expect(reps != 0, Phases::SEMANTIC, encompass(before_v, ctx.prev.view), STR_GREATER);
+			ctx.expect(reps <= STATIC_STEPS_MAX / seq.size, Phases::SEMANTIC, encompass(before_v, ctx.prev.view), STR_STATIC_LIMIT);
+
+			size_t count = seq.size;
+
+			for (size_t i = count; i != count * reps; ++i)
+				seq.push(seq.steps[i % count]);
+		} break;
+
+		case Symbols::BPM: {
+			View before_v = ctx.peek.view;
+			double bpm = static_literal_expr(ctx, 0);
+			seq.bpm = static_bpm(ctx, encompass(before_v, ctx.prev.view), bpm);
+		} break;
+
+		case Symbols::MAP: {
+			ctx.expect(is_literal_primary(ctx.peek), Phases::SYNTACTIC, ctx.peek.view, STR_LIT_EXPR);
+
+			// Notes past the last step are never used but still cycle.
+			std::array<uint8_t, STATIC_STEPS_MAX> notes {};
+			size_t n = 0;
+
+			while (is_literal_primary(ctx.peek)) {
+				uint8_t note = static_natural_expr(ctx);
+
+				if (n < notes.size())
+					notes[n] = note;
+
+				n++;
+			}
+
+			for (size_t i = 0; i != seq.size; ++i)
+				seq.steps[i].note = notes[i % n];
+		} break;
+
+		case Symbols::CHAIN: {
+			ctx.expect(ctx.peek.kind == Symbols::IDENT, Phases::SYNTACTIC, ctx.peek.view, STR_IDENT);
+			ctx.define(ctx.chains, ctx.next().view, seq);
+		} break;
+
+		default: { ctx.expect(false, Phases::SYNTACTIC, tok.view, STR_SEQ_OPERATOR); } break;
+	}
+
+	return seq;
+}
+
+constexpr StaticSequence static_sequence_expr(StaticContext& ctx, size_t bp) {
+	StaticSequence seq {};
+	seq.bpm = ctx.global_bpm;
+
+	Token tok = ctx.peek;
+
+	if (is_sequence_prefix(tok)) {
+		auto [lbp, rbp] = binding_power(tok.kind, OpFix::SEQ_PREFIX);
+		ctx.next();
+
+		seq = static_sequence_expr(ctx, rbp);
+
+		if (tok.kind == Symbols::REV) {
+			for (size_t i = 0; i != seq.size / 2; ++i) {
+				Event ev = seq.steps[i];
+				seq.steps[i] = seq.steps[seq.size - i - 1];
+				seq.steps[seq.size - i - 1] = ev;
+			}
+		}
+
+		else {
+			for (Event& ev: seq)
+				ev = !ev;
+		}
+	}
+
+	else
+		seq = static_sequence_primary(ctx, seq);
+
+	tok = ctx.peek;
+
+	while (is_sequence_infix(tok) or is_sequence_postfix(tok)) {
+		if (is_sequence_postfix(tok)) {
+			auto [lbp, rbp] = binding_power(tok.kind, OpFix::SEQ_POSTFIX);
+
+			if (lbp < bp)
+				break;
+
+			ctx.next();  // skip operator
+
+			if (tok.kind == Symbols::CAR)
+				seq.size = 1;
+
+			else if (tok.kind == Symbols::CDR and seq.size > 1) {
+				for (size_t i = 1; i != seq.size; ++i)
+					seq.steps[i - 1] = seq.steps[i];
+
+				seq.size--;
+			}
+		}
+
+		else {
+			auto [lbp, rbp] = binding_power(tok.kind, OpFix::SEQ_INFIX);
+
+			if (lbp < bp)
+				break;
+
+			seq = static_sequence_infix(ctx, seq, rbp);
+		}
+
+		tok = ctx.peek;
+	}
+
+	return seq;
+}
+
+// Statements
+constexpr Channel static_channel(StaticContext& ctx) {
+	Channel chan { ctx.port, CHANNEL_MIN };
+	Token tok = ctx.peek;
+
+	// Sink can be either a literal number on the current port or an alias
+	// defined previously which remembers its own port.
+	if (is_literal(tok)) {
+		double lit = static_literal(ctx);
+		ctx.expect(channel_fits(lit), Phases::SEMANTIC, tok.view, STR_BETWEEN);
+
+		chan.chan = lit;
+	}
+
+	else if (tok.kind == Symbols::IDENT) {
+		ctx.next();  // skip identifier
+
+		const Channel* alias = ctx.channels.find(tok.view);
+		ctx.expect(alias != nullptr, Phases::SEMANTIC, tok.view, STR_UNDEFINED);
+
+		chan = *alias;
+	}
+
+	else
+		ctx.expect(false, Phases::SYNTACTIC, tok.view, STR_IDENT_LITERAL);
+
+	chan.chan--;
+	return chan;
+}
+
+// Same grid refinement as `timeline_refine`.
+template <typename Out>
+constexpr void static_refine(StaticContext& ctx, Out& out, uint64_t bpm) {
+	Rate rate = rate_refine(ctx.rate, bpm);
+
+	if (rate == 0 or rate == ctx.rate)
+		return;
+
+	Tick factor = rate / ctx.rate;
+
+	out.scale(factor);
+
+	ctx.duration *= factor;
+	ctx.time *= factor;
+	ctx.rate = rate;
+}
+
+template <typename Out>
+constexpr Tick static_send(StaticContext& ctx, Out& out, Tick& time) {
+	View stat_v = ctx.peek.view;
+
+	ctx.expect(ctx.peek.kind == Symbols::SEND, Phases::SYNTACTIC, ctx.peek.view, STR_EXPECT);
+	ctx.next();  // skip `send`
+
+	Channel chan = static_channel(ctx);
+	StaticSequence seq = static_sequence_expr(ctx, 0);
+
+	View send_v = encompass(stat_v, ctx.prev.view);
+
+	Rate before = ctx.rate;
+	static_refine(ctx, out, seq.bpm);
+	time *= ctx.rate / before;
+
+	Tick end = time + step_tick(seq.size, seq.bpm, ctx.rate);
+	size_t beats = 0;
+
+	for (const Event& ev: seq)
+		beats += ev.kind == BEAT;
+
+	// Held to the default budget, see `budget_events`.
+	double minutes = static_cast<double>(std::max(end, ctx.duration)) / ctx.rate;
+	double total = out.count + 2.0 * beats + realtime_events(minutes, minutes, ctx.global_bpm);
+
+	ctx.expect(budget_events_fit(Budget {}, total), Phases::SEMANTIC, send_v, STR_BUDGET_EVENTS);
+
+	for (size_t k = 0; k != seq.size; ++k) {
+		auto [note, kind] = seq.steps[k];
+
+		if (kind == BEAT) {
+			auto [on, off] = beat_events(time, k, seq.bpm, ctx.rate, chan, note);
+
+			out.push(on);
+			out.push(off);
+		}
+	}
+
+	return end;
+}
+
+template <typename Out>
+constexpr void static_statement(StaticContext& ctx, Out& out) {
+	Token tok = ctx.peek;
+
+	if (tok.kind == Symbols::ALIAS) {
+		ctx.next();  // skip `alias`
+
+		ctx.expect(ctx.peek.kind == Symbols::IDENT, Phases::SYNTACTIC, ctx.peek.view, STR_IDENT);
+		View view = ctx.next().view;
+
+		double lit = static_literal(ctx);
+		ctx.expect(channel_fits(lit), Phases::SEMANTIC, ctx.prev.view, STR_BETWEEN);
+
+		ctx.define(ctx.channels, view, Channel { ctx.port, static_cast<uint8_t>(lit) });
+	}
+
+	else if (tok.kind == Symbols::PORT) {
+		ctx.next();  // skip `port`
+
+		ctx.expect(ctx.peek.kind == Symbols::IDENT, Phases::SYNTACTIC, ctx.peek.view, STR_IDENT);
+		View view = ctx.next().view;
+
+		size_t i = 0;
+
+		while (i != ctx.nports and view != View { ctx.ports[i].data() })
+			++i;
+
+		if (i == ctx.nports) {
+			ctx.expect(ctx.nports != PORT_MAX, Phases::SEMANTIC, view, STR_PORT_MAX);
+			ctx.expect(view.size() < PORT_NAME_MAX, Phases::SEMANTIC, view, STR_PORT_NAME);
+
+			ctx.ports[ctx.nports++] = port_name(view);
+		}
+
+		ctx.port = i;
+	}
+
+	else if (tok.kind == Symbols::LET) {
+		ctx.next();  // skip `let`
+
+		ctx.expect(ctx.peek.kind == Symbols::IDENT, Phases::SYNTACTIC, ctx.peek.view, STR_IDENT);
+		View view = ctx.next().view;
+
+		double lit = static_literal_expr(ctx, 0);
+		ctx.define(ctx.constants, view, lit);
+	}
+
+	else if (tok.kind == Symbols::TEMPO)
+		ctx.expect(false, Phases::SEMANTIC, tok.view, STR_STATIC_TEMPO);
+
+	else if (is_sequence_primary(tok) or is_sequence_prefix(tok))
+		static_cast<void>(static_sequence_expr(ctx, 0));
+
+	else if (tok.kind == Symbols::SEND) {
+		Tick orig = ctx.time;
+
+		while (true) {
+			Tick end = static_send(ctx, out, orig);
+
+			ctx.time = std::max(end, ctx.time);
+			ctx.duration = std::max(end, ctx.duration);
+
+			if (ctx.peek.kind != Symbols::WITH)
+				break;
+
+			ctx.next();  // skip `$`
+		}
+	}
+
+	else
+		ctx.expect(false, Phases::SYNTACTIC, tok.view, STR_STATEMENT);
+}
+
+// Everything `compile` does up to sorting, including clock and sensing.
+template <typename Out>
+constexpr void static_build(StaticContext& ctx, Out& out) {
+	ctx.expect(validate(ctx.src), Phases::ENCODING, ctx.src, STR_ENCODING);
+
+	ctx.ports[ctx.nports++] = port_name(STR_PORT);
+	ctx.next();  // important
+
+	bool has_bpm = false;
+	bool has_note = false;
+
+	while (is_meta(ctx.peek)) {
+		Token tok = ctx.next();
+
+		if (tok.kind == Symbols::GLOBAL_BPM) {
+			View bpm_v = ctx.peek.view;
+			double bpm = static_literal_expr(ctx, 0);
+
+			ctx.global_bpm = static_bpm(ctx, encompass(bpm_v, ctx.prev.view), bpm);
+			has_bpm = true;
+		}
+
+		else {
+			ctx.global_note = static_natural_expr(ctx);
+			has_note = true;
+		}
+	}
+
+	ctx.expect(has_bpm, Phases::SEMANTIC, ctx.peek.view, STR_NO_BPM);
+	ctx.expect(has_note, Phases::SEMANTIC, ctx.peek.view, STR_NO_NOTE);
+
+	ctx.rate = timeline_rate(ctx.global_bpm);
+
+	while (ctx.peek.kind != Symbols::TERMINATOR)
+		static_statement(ctx, out);
+
+	if (out.count == 0)
+		return;
+
+	auto emit = [&] (const MidiEvent& ev) {
+		out.push(ev);
+	};
+
+	realtime_sensing(ctx.duration, ctx.rate, emit);
+	realtime_clock(ctx.duration, ctx.global_bpm, ctx.rate, emit);
+}
+
+// Number of events `src` compiles to.
+constexpr size_t static_size(View src) {
+	StaticContext ctx { src };
+	StaticCounter out {};
+
+	static_build(ctx, out);
+
+	return out.count == 0 ? 0u : out.count + BOOKEND_EVENTS;
+}
+
+template <size_t N>
+struct StaticTimeline {
+	std::array<MidiEvent, N> events {};
+
+	Tick duration = 0;
+	uint64_t bpm = BPM_DEFAULT;
+	Rate rate = timeline_rate(BPM_DEFAULT);
+
+	std::array<PortName, PORT_MAX> ports {};
+	size_t nports = 0;
+
+	constexpr TimelineView view() const {
+		return {
+			events.data(), events.data() + N, duration, bpm, rate,
+			{}, { ports.data(), ports.data() + nports }
+		};
+	}
+};
+
+// Stable merge sort by time over `[first, last)`.
+template <size_t N>
+constexpr void static_sort(std::array<MidiEvent, N>& events, size_t first, size_t last) {
+	std::array<MidiEvent, N> tmp {};
+
+	for (size_t width = 1; width < last - first; width *= 2) {
+		for (size_t lo = first; lo < last; lo += 2 * width) {
+			size_t mid = std::min(lo + width, last);
+			size_t hi = std::min(lo + 2 * width, last);
+
+			size_t i = lo, j = mid, k = lo;
+
+			while (i != mid and j != hi)
+				tmp[k++] = events[j].time < events[i].time ? events[j++] : events[i++];
+
+			while (i != mid) tmp[k++] = events[i++];
+			while (j != hi)  tmp[k++] = events[j++];
+		}
+
+		for (size_t i = first; i != last; ++i)
+			events[i] = tmp[i];
+	}
+}
+
+// `N` has to be `static_size(src)`.
+template <size_t N>
+constexpr StaticTimeline<N> static_compile(View src) {
+	StaticTimeline<N> tl {};
+
+	StaticContext ctx { src };
+	StaticBuffer<N> out { tl.events, N == 0 ? 0u : BOOKEND_EVENTS - 1u };
+
+	static_build(ctx, out);
+
+	tl.duration = ctx.duration;
+	tl.bpm = ctx.global_bpm;
+	tl.rate = ctx.rate;
+	tl.ports = ctx.ports;
+	tl.nports = ctx.nports;
+
+	if constexpr (N != 0) {
+		static_sort(tl.events, out.first, out.first + out.count);
+
+		auto front = bookend_front();
+
+		for (size_t i = 0; i != front.size(); ++i)
+			tl.events[i] = front[i];
+
+		tl.events[N - 1] = bookend_back(tl.duration);
+	}
+
+	return tl;
+}
+
+}
+
+// Compile a string literal into a `StaticTimeline`. Use it to initialise a
+// `constexpr` variable to be sure it is evaluated at compile time.
+#define CANE_STATIC(str) \
+	cane::static_compile<cane::static_size(cane::View { str })>(cane::View { str })
+
+#endif
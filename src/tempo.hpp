@@ -0,0 +1,133 @@
+#ifndef CANE_TEMPO_HPP
+#define CANE_TEMPO_HPP
+
+namespace cane {
+
+// Tempo map.
+// Ticks count musical time at the global BPM. The tempo map is a list of
+// segments, each either constant or a linear ramp in BPM, which says how
+// long a tick actually lasts. Sequences, the MIDI clock and everything else
+// are laid out once in ticks and only the conversion to real time changes
+// so tempo automation never needs anything to be recompiled.
+//
+// Every point stores the real time at which it starts (a prefix sum over
+// the segments before it) so converting either way is a binary search for
+// the segment followed by a closed form within it.
+
+// Seconds from the start of segment `p` to `dt` ticks into it. A ramp
+// scales the tempo by `1 + slope * dt` so the time taken is the integral
+// of `spt / (1 + slope * x)`.
+inline double segment_seconds(const TempoPoint& p, double dt) {
+	if (p.slope == 0.0)
+		return dt * p.spt;
+
+	return p.spt * std::log1p(p.slope * dt) / p.slope;
+}
+
+// Inverse of `segment_seconds`.
+inline double segment_ticks(const TempoPoint& p, double ds) {
+	if (p.slope == 0.0)
+		return ds / p.spt;
+
+	return std::expm1(p.slope * ds / p.spt) / p.slope;
+}
+
+// Build the map from `tempo` statements in the order they were written.
+// Nothing is built if the tempo never changes so conversions stay exact.
+inline std::vector<TempoPoint> tempo_map(const std::vector<TempoMark>& marks, uint64_t bpm, Rate rate) {
+	CANE_LOG(LogLevel::INF);
+
+	std::vector<TempoPoint> points;
+
+	if (marks.empty())
+		return points;
+
+	auto spt = [&] (double b) {
+		return 60.0 / static_cast<double>(rate) * static_cast<double>(bpm) / b;
+	};
+
+	points.reserve(marks.size() + 1);
+	points.push_back({ 0, 0.0, spt(bpm), 0.0 });
+
+	double current = bpm;  // Tempo at the start of the last point.
+
+	for (const TempoMark& mark: marks) {
+		TempoPoint& p = points.back();
+		Tick dt = mark.time - p.time;
+
+		// Changes at the same tick replace each other.
+		if (dt <= 0) {
+			p.spt = spt(mark.bpm);
+			current = mark.bpm;
+			continue;
+		}
+
+		if (mark.ramp)
+			p.slope = (mark.bpm / current - 1.0) / static_cast<double>(dt);
+
+		double seconds = p.seconds + segment_seconds(p, dt);
+
+		points.push_back({ mark.time, seconds, spt(mark.bpm), 0.0 });
+		current = mark.bpm;
+	}
+
+	return points;
+}
+
+// Real time at tick `t`.
+inline UnitSeconds tempo_seconds(TempoView tempo, Tick t, Rate rate) {
+	if (tempo.empty())
+		return tick_seconds(t, rate);
+
+	t = std::max(t, Tick { 0 });
+
+	const TempoPoint* it = std::upper_bound(tempo.begin(), tempo.end(), t, [] (Tick t, const TempoPoint& p) {
+		return t < p.time;
+	});
+
+	const TempoPoint& p = *std::prev(it);
+	return UnitSeconds { p.seconds + segment_seconds(p, t - p.time) };
+}
+
+// First tick at or after real time `s`.
+inline Tick tempo_tick(TempoView tempo, UnitSeconds s, Rate rate) {
+	if (tempo.empty())
+		return std::ceil(s.count() * static_cast<double>(rate) / 60.0);
+
+	const TempoPoint* it = std::upper_bound(tempo.begin(), tempo.end(), s.count(), [] (double s, const TempoPoint& p) {
+		return s < p.seconds;
+	});
+
+	const TempoPoint& p = *std::prev(it);
+	return p.time + static_cast<Tick>(std::ceil(segment_ticks(p, s.count() - p.seconds)));
+}
+
+inline UnitSeconds timeline_seconds(TimelineView tl, Tick t) {
+	return tempo_seconds(tl.tempo, t, tl.rate);
+}
+
+inline std::ostream& operator<<(std::ostream& os, TimelineView tl) {
+	constexpr auto longest = *std::max_element(MIDI_TO_STRING.begin(), MIDI_TO_STRING.end(), [] (auto& lhs, auto& rhs) {
+		return lhs.size() < rhs.size();
+	});
+
+	for (const MidiEvent& ev: tl) {
+		View sv = int2midi(ev.data[0]);
+		std::string padding(longest.size() - sv.size(), ' ');
+
+		// French flag
+		print(os, CANE_BLUE, sv, padding, CANE_RESET " ");
+
+		print(os, "[ ", CANE_BOLD, (int)ev.data[1], " ");
+		print(os, (int)ev.data[2], CANE_RESET " ] ");
+
+		print(os, CANE_RED, UnitMillis { timeline_seconds(tl, ev.time) }.count(), cane::STR_MILLI_SUFFIX, CANE_RESET);
+		println(os);
+	}
+
+	return os;
+}
+
+}
+
+#endif
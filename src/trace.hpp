@@ -0,0 +1,207 @@
+#ifndef CANE_TRACE_HPP
+#define CANE_TRACE_HPP
+
+// Tracing
+// Scoped spans and counters are recorded into fixed size per-thread rings
+// and written out as Chrome trace JSON (viewable in Perfetto or
+// chrome://tracing). A ring never fills up, it keeps the most recent
+// `TRACE_CAPACITY` records of its thread so a long set still ends with a
+// trace of its last moments. Recording is off until `trace_start` is called
+// and costs a single relaxed load per span while off. Define
+// `CANE_NO_TRACING` to remove it entirely at compile time.
+namespace cane {
+	constexpr size_t TRACE_CAPACITY = 1u << 16;  // Records per thread.
+	static_assert((TRACE_CAPACITY & (TRACE_CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+	enum class TraceKind: uint8_t {
+		SPAN,
+		COUNTER,
+	};
+
+	struct TraceRecord {
+		View name;
+		TraceKind kind;
+
+		uint64_t begin;  // ns since `trace_start`
+		uint64_t value;  // Duration in ns for spans.
+	};
+
+	// Only ever written to by its owning thread. `count` is every record
+	// pushed so far and is published with release semantics, record `i`
+	// lives at `i % TRACE_CAPACITY` until it is overwritten.
+	struct TraceBuffer {
+		std::unique_ptr<TraceRecord[]> records;
+		std::atomic<size_t> count = 0;
+
+		View thread;
+		size_t tid;
+
+		inline TraceBuffer(View thread_, size_t tid_):
+			records(new TraceRecord[TRACE_CAPACITY]), thread(thread_), tid(tid_) {}
+
+		inline void push(TraceRecord record) {
+			size_t n = count.load(std::memory_order_relaxed);
+
+			records[n % TRACE_CAPACITY] = record;
+			count.store(n + 1, std::memory_order_release);
+		}
+
+		// The most recent records in order. The owning thread might still
+		// be running so anything it overwrote while they were copied is
+		// left out.
+		inline std::vector<TraceRecord> window() const {
+			size_t last = count.load(std::memory_order_acquire);
+			size_t first = last > TRACE_CAPACITY ? last - TRACE_CAPACITY : 0u;
+
+			std::vector<TraceRecord> out;
+			out.reserve(last - first);
+
+			for (size_t i = first; i != last; ++i)
+				out.push_back(records[i % TRACE_CAPACITY]);
+
+			if (size_t now = count.load(std::memory_order_acquire); now - first > TRACE_CAPACITY)
+				out.erase(out.begin(), out.begin() + std::min(now - first - TRACE_CAPACITY, out.size()));
+
+			return out;
+		}
+	};
+
+	namespace detail {
+		struct TraceState {
+			std::atomic<bool> enabled = false;
+			std::chrono::steady_clock::time_point epoch {};
+
+			std::mutex lock;
+			std::vector<std::unique_ptr<TraceBuffer>> buffers;
+		};
+
+		inline TraceState trace_state {};
+		inline thread_local TraceBuffer* trace_buffer = nullptr;
+	}
+
+	inline bool trace_enabled() {
+		return detail::trace_state.enabled.load(std::memory_order_relaxed);
+	}
+
+	inline void trace_start() {
+		detail::trace_state.epoch = std::chrono::steady_clock::now();
+		detail::trace_state.enabled.store(true, std::memory_order_release);
+	}
+
+	inline uint64_t trace_now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - detail::trace_state.epoch
+		).count();
+	}
+
+	// Allocates the calling thread's buffer. Threads which can't allocate
+	// once running (i.e. the JACK process thread) must call this up front,
+	// every other thread gets a buffer on first use.
+	inline TraceBuffer& trace_register_thread(View name = "thread"_sv) {
+		if (detail::trace_buffer != nullptr)
+			return *detail::trace_buffer;
+
+		auto& state = detail::trace_state;
+		std::lock_guard<std::mutex> guard { state.lock };
+
+		auto& buffer = state.buffers.emplace_back(std::make_unique<TraceBuffer>(name, state.buffers.size()));
+		detail::trace_buffer = buffer.get();
+
+		return *buffer;
+	}
+
+	inline void trace_counter(View name, uint64_t value) {
+		if (not trace_enabled())
+			return;
+
+		trace_register_thread().push({ name, TraceKind::COUNTER, trace_now(), value });
+	}
+
+	struct TraceSpan {
+		View name;
+		uint64_t begin = 0;
+		bool active = false;
+
+		inline TraceSpan(View name_): name(name_) {
+			if (trace_enabled()) {
+				begin = trace_now();
+				active = true;
+			}
+		}
+
+		inline ~TraceSpan() {
+			if (active)
+				trace_register_thread().push({ name, TraceKind::SPAN, begin, trace_now() - begin });
+		}
+	};
+
+	namespace detail {
+		inline std::ostream& trace_escape(std::ostream& os, View sv) {
+			for (const char* ptr = sv.begin; ptr != sv.end; ++ptr) {
+				if (*ptr == '"' or *ptr == '\\')
+					os << '\\';
+
+				os << *ptr;
+			}
+
+			return os;
+		}
+	}
+
+	inline std::ostream& trace_write(std::ostream& os) {
+		auto& state = detail::trace_state;
+		std::lock_guard<std::mutex> guard { state.lock };
+
+		auto us = [] (uint64_t ns) {
+			return static_cast<double>(ns) / 1000.0;
+		};
+
+		const char* sep = "";
+		os << std::fixed << std::setprecision(3);
+
+		print(os, "{ \"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+
+		for (auto& buffer: state.buffers) {
+			print(os, sep, "{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": ", buffer->tid, ", \"args\": { \"name\": \"");
+			detail::trace_escape(os, buffer->thread);
+			print(os, "\" } }");
+
+			sep = ",\n";
+
+			std::vector<TraceRecord> records = buffer->window();
+
+			for (const TraceRecord& r: records) {
+				print(os, sep, "{ \"name\": \"");
+				detail::trace_escape(os, r.name);
+				print(os, "\", \"pid\": 0, \"tid\": ", buffer->tid, ", \"ts\": ", us(r.begin), ", ");
+
+				switch (r.kind) {
+					case TraceKind::SPAN:    print(os, "\"ph\": \"X\", \"dur\": ", us(r.value), " }"); break;
+					case TraceKind::COUNTER: print(os, "\"ph\": \"C\", \"args\": { \"value\": ", r.value, " } }"); break;
+				}
+			}
+
+			if (size_t count = buffer->count.load(std::memory_order_relaxed); count > records.size())
+				general_warning(STR_TRACE_DROPPED, count - records.size(), buffer->thread);
+		}
+
+		return print(os, "\n] }\n");
+	}
+
+	#ifndef CANE_NO_TRACING
+		constexpr bool TRACE_AVAILABLE = true;
+
+		#define CANE_TRACE_SPAN(name) \
+			cane::TraceSpan CANE_VAR(span) { (name) }
+
+		#define CANE_TRACE_COUNTER(name, value) \
+			cane::trace_counter((name), (value))
+	#else
+		constexpr bool TRACE_AVAILABLE = false;
+
+		#define CANE_TRACE_SPAN(name) do {} while (0)
+		#define CANE_TRACE_COUNTER(name, value) do {} while (0)
+	#endif
+}
+
+#endif
@@ -8,16 +8,60 @@ struct Token {
 	cane::Symbols kind = Symbols::NONE;
 };
 
-using Unit        = std::chrono::microseconds;
 using UnitSeconds = std::chrono::duration<double>;
 using UnitMillis  = std::chrono::duration<double, std::milli>;
+using UnitMicros  = std::chrono::duration<double, std::micro>;
 
-constexpr auto ONE_MIN = std::chrono::duration_cast<Unit>(std::chrono::minutes { 1 });
+constexpr auto ONE_MIN = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::minutes { 1 });
+
+// Time is counted in ticks on an integer grid. The number of ticks per
+// minute is chosen per timeline as the LCM of every step rate in use so
+// that steps at any BPM land exactly on the grid and long sends never
+// drift apart. Ticks are only converted to frames or seconds at output.
+using Tick = int64_t;
+using Rate = uint64_t;  // Ticks per minute.
+
+// Grids finer than this would risk overflow, past it steps are rounded to
+// the nearest tick instead (which still never accumulates).
+constexpr Rate RATE_MAX = 1ull << 36;
+
+constexpr Rate rate_lcm(Rate a, Rate b) {
+	return a / std::gcd(a, b) * b;
+}
+
+// Grid that steps at `bpm` land on exactly, `rate` itself if they already
+// do and zero if it would be finer than `RATE_MAX`.
+constexpr Rate rate_refine(Rate rate, uint64_t bpm) {
+	if (rate % bpm == 0)
+		return rate;
+
+	Rate out = rate_lcm(rate, bpm);
+	return out > RATE_MAX ? 0 : out;
+}
+
+// Coarsest grid holding the MIDI clock and active sensing at `bpm`.
+constexpr Rate timeline_rate(uint64_t bpm) {
+	Rate sensing = std::chrono::minutes { 1 } / ACTIVE_SENSING_INTERVAL;
+	return rate_lcm(bpm * CLOCK_PPQ, sensing);
+}
+
+// Tick at which step `k` of something running at `per_min` steps per
+// minute falls, relative to its start. Split to stay clear of overflow.
+constexpr Tick step_tick(uint64_t k, uint64_t per_min, Rate rate) {
+	return (k / per_min) * rate + (k % per_min) * rate / per_min;
+}
+
+constexpr UnitSeconds tick_seconds(Tick t, Rate rate) {
+	return UnitSeconds { 60.0 * static_cast<double>(t) / static_cast<double>(rate) };
+}
 
 struct Event {
 	uint8_t note;
 	uint8_t kind;
 
+	constexpr Event():
+		Event(SKIP) {}
+
 	constexpr Event(uint8_t kind_):
 		note(NOTE_DEFAULT),
 		kind(kind_) {}
@@ -28,44 +72,265 @@ struct Event {
 };
 
 struct MidiEvent {
-	Unit time;
+	Tick time;
 	std::array<uint8_t, 3> data;
 
-	constexpr MidiEvent(Unit time_, uint8_t status, uint8_t note, uint8_t velocity):
-		time(time_), data({status, note, velocity}) {}
+	// Both fit in what would otherwise be padding.
+	uint8_t port;
+	uint8_t size;  // Bytes of `data` that go out on the wire.
+
+	constexpr MidiEvent():
+		MidiEvent(0, 0, 0, 0) {}
+
+	constexpr MidiEvent(Tick time_, uint8_t status, uint8_t note, uint8_t velocity, uint8_t port_ = PORT_DEFAULT):
+		time(time_), data({status, note, velocity}), port(port_), size(midi_length(status)) {}
 };
 
+// A MIDI channel on one of the output ports.
+struct Channel {
+	uint8_t port = PORT_DEFAULT;
+	uint8_t chan = 0;
+};
+
+using PortName = std::array<char, PORT_NAME_MAX>;
+
+// Names longer than `PORT_NAME_MAX - 1` are truncated.
+constexpr PortName port_name(View sv) {
+	PortName name {};
+
+	for (size_t i = 0; i != std::min(sv.size(), PORT_NAME_MAX - 1); ++i)
+		name[i] = sv.begin[i];
+
+	return name;
+}
+
+struct Layer;
+
 struct Sequence: public std::vector<Event> {
 	uint64_t bpm = BPM_DEFAULT;
+
+	// Operands of `||`, `&&` and `^^` not yet combined with the steps
+	// above, see `sequence_poly`.
+	std::vector<Layer> layers;
+
 	Sequence(): std::vector<Event>::vector() {}
 };
 
+struct Layer {
+	Symbols op;
+	Sequence seq;
+};
+
+// Source of a `send` and the span of time its events cover.
+struct Origin {
+	View view;
+	Tick begin;
+	Tick end;
+};
+
+// A send compiled as one period of its sequence which repeats `count`
+// times, `period` ticks apart. This only saves work while compiling, a
+// repetitive song lays out its bars and rescales them for a finer grid
+// once. Blocks are flattened before the timeline is handed over, which
+// still holds every event, so nothing is saved once compiled.
+struct Block {
+	std::vector<MidiEvent> events;  // First repeat only.
+	Tick period = 0;
+	uint64_t count = 1;
+};
+
+// A send kept as-is so it can be looped rather than laid out once.
+struct Loop {
+	Sequence seq;
+	Channel channel;
+};
+
+// A `tempo` statement as written: jump to `bpm` at `time` or ramp to it
+// from the previous change.
+struct TempoMark {
+	Tick time;
+	double bpm;
+	bool ramp;
+};
+
+// Tempo from `time` until the next point. Ticks are musical time at the
+// global BPM and points map them to real time. Each carries the real time
+// at which it falls so that converting a tick only looks at one segment.
+struct TempoPoint {
+	Tick time = 0;
+	double seconds = 0.0;  // Real time at `time`.
+	double spt = 0.0;      // Seconds per tick at `time`.
+	double slope = 0.0;    // Relative change in tempo per tick, zero if constant.
+};
+
+// Non-owning view over a contiguous array, i.e. part of a mapped timeline.
+template <typename T>
+struct ArrayView {
+	const T* first = nullptr;
+	const T* last  = nullptr;
+
+	constexpr ArrayView() {}
+
+	constexpr ArrayView(const T* first_, const T* last_):
+		first(first_), last(last_) {}
+
+	inline ArrayView(const std::vector<T>& v):
+		first(v.data()), last(v.data() + v.size()) {}
+
+	constexpr const T* begin() const { return first; }
+	constexpr const T* end() const { return last; }
+
+	constexpr size_t size() const { return last - first; }
+	constexpr bool empty() const { return first == last; }
+
+	constexpr const T& operator[](size_t i) const { return first[i]; }
+};
+
+using TempoView = ArrayView<TempoPoint>;
+using PortView  = ArrayView<PortName>;
+
 struct Timeline: public std::vector<MidiEvent> {
-	Unit duration = Unit::zero();
+	Tick duration = 0;
+	uint64_t bpm = BPM_DEFAULT;
+	Rate rate = timeline_rate(BPM_DEFAULT);
+	std::vector<Origin> origins;
+	std::vector<TempoPoint> tempo;  // Empty if the tempo never changes.
+	std::vector<PortName> ports;    // Indexed by `MidiEvent::port`.
 	Timeline(): std::vector<MidiEvent>::vector() {}
 };
 
+// Non-owning view over a contiguous run of events. This lets the player
+// walk either a freshly compiled `Timeline` or one mapped from disk.
+struct TimelineView {
+	const MidiEvent* first = nullptr;
+	const MidiEvent* last  = nullptr;
+
+	Tick duration = 0;
+	uint64_t bpm = BPM_DEFAULT;
+	Rate rate = timeline_rate(BPM_DEFAULT);
+	TempoView tempo {};
+	PortView ports {};
+
+	constexpr TimelineView() {}
+
+	constexpr TimelineView(
+		const MidiEvent* first_,
+		const MidiEvent* last_,
+		Tick duration_,
+		uint64_t bpm_,
+		Rate rate_,
+		TempoView tempo_ = {},
+		PortView ports_ = {}
+	):
+		first(first_), last(last_), duration(duration_), bpm(bpm_), rate(rate_), tempo(tempo_), ports(ports_) {}
+
+	inline TimelineView(const Timeline& tl):
+		first(tl.data()), last(tl.data() + tl.size()), duration(tl.duration), bpm(tl.bpm), rate(tl.rate),
+		tempo(tl.tempo), ports(tl.ports) {}
+
+	constexpr const MidiEvent* begin() const { return first; }
+	constexpr const MidiEvent* end() const { return last; }
+
+	constexpr size_t size() const { return last - first; }
+	constexpr bool empty() const { return first == last; }
+};
+
 using Handler = void(*)(Phases, View, View, std::string);
 
+// Where diagnostics go. `user` is handed back untouched so that whoever
+// compiles can collect them without any global state.
+struct Reporter {
+	using Callback = void(*)(void*, Reports, Phases, View, View, std::string);
+
+	Callback fn = nullptr;
+	void* user = nullptr;
+
+	inline void operator()(Reports kind, Phases phase, View original, View sv, std::string str) const {
+		if (fn != nullptr)
+			fn(user, kind, phase, original, sv, std::move(str));
+	}
+};
+
+// Compile-time statistics. Timers are only read when `enabled` is set so
+// they cost next to nothing otherwise.
+struct Stats {
+	using Duration = std::chrono::nanoseconds;
+
+	bool enabled = false;
+
+	Duration lexing    = Duration::zero();
+	Duration parsing   = Duration::zero();  // Parsing and evaluation, excluding lexing and compiling.
+	Duration compiling = Duration::zero();  // `sequence_compile`
+	Duration realtime  = Duration::zero();  // Clock and active sensing generation.
+	Duration sorting   = Duration::zero();
+	Duration bookend   = Duration::zero();  // Start/stop and device reset messages.
+	Duration total     = Duration::zero();
+
+	size_t tokens = 0;
+	size_t steps  = 0;  // Steps materialized by sequence expressions.
+	size_t events = 0;
+};
+
+struct StatTimer {
+	using clock = std::chrono::steady_clock;
+
+	Stats& stats;
+	Stats::Duration& acc;
+	clock::time_point start;
+
+	inline StatTimer(Stats& stats_, Stats::Duration& acc_):
+		stats(stats_), acc(acc_)
+	{
+		if (stats.enabled)
+			start = clock::now();
+	}
+
+	inline ~StatTimer() {
+		if (stats.enabled)
+			acc += clock::now() - start;
+	}
+};
+
+// Most that compiling a song may allocate. Everything held at once, chains,
+// blocks, operands and the timeline, may take no more than `memory` bytes
+// and the timeline may have no more than `events` events. Sizes are worked
+// out before allocating so a typo is reported rather than running the
+// machine out of memory.
+struct Budget {
+	size_t memory = BUDGET_MEMORY;
+	size_t events = BUDGET_EVENTS;
+};
+
 struct Context {
 	std::unordered_map<View, double> constants;
-	std::unordered_map<View, uint8_t> channels;
+	std::unordered_map<View, Channel> channels;
 	std::unordered_map<View, Sequence> chains;
 
 	std::unordered_set<View> symbols;
 
-	Timeline tl;
-	Unit time = Unit::zero();
+	Timeline tl;  // Everything but the events which are in `blocks`.
+	std::vector<Block> blocks;
+	size_t events = 0;  // Once `blocks` are laid out.
+
+	Tick time = 0;
+	Rate rate = timeline_rate(BPM_DEFAULT);
+	bool inexact = false;  // Grid outgrew `RATE_MAX`.
+
+	std::vector<TempoMark> tempo;
+	uint8_t port = PORT_DEFAULT;  // Where numeric channels and new aliases go.
+
+	Stats stats;
+	Budget budget;
+	size_t live = 0;  // Bytes of chains, blocks and operands held against `budget`.
+	std::vector<Loop>* loops = nullptr;  // Sends are also collected here when set.
 
 	size_t global_bpm;
 	size_t global_note;
 
-	Handler error_handler;
-	Handler warning_handler;
-	Handler notice_handler;
+	Reporter reporter;
 
-	inline Context(Handler&& error_handler_, Handler&& warning_handler_, Handler&& notice_handler_):
-		error_handler(error_handler_), warning_handler(warning_handler_), notice_handler(notice_handler_) {}
+	inline Context(Reporter reporter_):
+		reporter(reporter_) {}
 };
 
 inline std::ostream& operator<<(std::ostream& os, Sequence& s) {
@@ -75,29 +340,6 @@ inline std::ostream& operator<<(std::ostream& os, Sequence& s) {
 	return print(os, CANE_RESET);
 }
 
-
-inline std::ostream& operator<<(std::ostream& os, Timeline& tl) {
-	constexpr auto longest = *std::max_element(MIDI_TO_STRING.begin(), MIDI_TO_STRING.end(), [] (auto& lhs, auto& rhs) {
-		return lhs.size() < rhs.size();
-	});
-
-	for (MidiEvent& ev: tl) {
-		View sv = int2midi(ev.data[0]);
-		std::string padding(longest.size() - sv.size(), ' ');
-
-		// French flag
-		print(os, CANE_BLUE, sv, padding, CANE_RESET " ");
-
-		print(os, "[ ", CANE_BOLD, (int)ev.data[1], " ");
-		print(os, (int)ev.data[2], CANE_RESET " ] ");
-
-		print(os, CANE_RED, UnitMillis { ev.time }.count(), cane::STR_MILLI_SUFFIX, CANE_RESET);
-		println(os);
-	}
-
-	return os;
-}
-
 }
 
 #endif
@@ -16,6 +16,16 @@ namespace cane {
 
 // Utilities
 namespace cane {
+	// `std::is_constant_evaluated` from C++20. Anywhere the builtin isn't
+	// available it errs on the side of a constant expression.
+	[[nodiscard]] constexpr bool is_constant_evaluated() {
+		#if defined(__GNUC__) or defined(__clang__)
+			return __builtin_is_constant_evaluated();
+		#else
+			return true;
+		#endif
+	}
+
 	template <typename T, typename... Ts>
 	[[nodiscard]] constexpr bool any(T&& first, Ts&&... rest) {
 		return ((std::forward<T>(first) or std::forward<Ts>(rest)) or ...);
@@ -52,8 +52,9 @@ namespace cane {
 	// 2. Compare lengths
 	// 3. Compare characters
 	constexpr bool operator==(View lhs, View rhs) {
-		// Compare the pointers.
-		if (lhs.begin == rhs.begin and lhs.end == rhs.end)
+		// Compare the pointers. Two string literals may share storage so
+		// comparing their addresses isn't a constant expression.
+		if (not is_constant_evaluated() and lhs.begin == rhs.begin and lhs.end == rhs.end)
 			return true;
 
 		// Compare the length.